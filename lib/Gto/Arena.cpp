@@ -34,28 +34,64 @@
 //  DAMAGE.
 //
 
-#include "zhacks.h"
+#include "Arena.h"
 
-#ifdef GTO_SUPPORT_ZIP
+namespace Gto {
 
-z_off_t gzseek_raw(gzFile file, z_off_t raw_offset)
+Arena::Arena(size_t slabSize)
+    : m_next(0), m_left(0), m_slabSize(roundUp(slabSize)), m_used(0)
 {
-    gz_stream *s = (gz_stream*)file;
-
-    if (s == NULL || s->gto_mode != 'r') return -1;
-
-    s->gto_start = raw_offset;
-
-    s->gto_z_err = Z_OK;
-    s->gto_z_eof = 0;
-    s->gto_back = EOF;
-    s->gto_stream.avail_in = 0;
-    s->gto_stream.next_in = s->gto_inbuf;
-    s->gto_crc = crc32(0L, Z_NULL, 0);
-    inflateReset(&s->gto_stream);
-    s->gto_in = 0;
-    s->gto_out = 0;
-    return fseek(s->gto_z_file, s->gto_start, SEEK_SET);
 }
 
-#endif
+Arena::~Arena()
+{
+    clear();
+}
+
+void
+Arena::clear()
+{
+    for (size_t i=0; i < m_slabs.size(); i++) delete [] m_slabs[i];
+    m_slabs.clear();
+    m_next = 0;
+    m_left = 0;
+    m_used = 0;
+}
+
+void
+Arena::newSlab(size_t bytes)
+{
+    //
+    //  Over allocate so the start can be aligned whatever new[] gives
+    //
+
+    char* slab = new char[bytes + 15];
+    m_slabs.push_back(slab);
+
+    size_t misalign = size_t(slab) & 15;
+    m_next = slab + (misalign ? 16 - misalign : 0);
+    m_left = bytes;
+}
+
+void
+Arena::reserve(size_t bytes)
+{
+    if (bytes > m_left) newSlab(roundUp(bytes));
+}
+
+void*
+Arena::allocate(size_t bytes)
+{
+    if (bytes == 0) return 0;
+
+    size_t n = roundUp(bytes);
+    if (n > m_left) newSlab(n > m_slabSize ? n : m_slabSize);
+
+    void* p = m_next;
+    m_next += n;
+    m_left -= n;
+    m_used += n;
+    return p;
+}
+
+} // Gto
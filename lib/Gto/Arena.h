@@ -0,0 +1,89 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+#ifndef __Gto__Arena__h__
+#define __Gto__Arena__h__
+
+#include <Gto/config.h>
+#include <stddef.h>
+#include <vector>
+
+namespace Gto {
+
+//
+//  class Arena
+//
+//  Hands out memory from a few large slabs. Nothing is freed until
+//  the arena is cleared or destroyed. Allocations are 16 byte
+//  aligned. Not thread safe.
+//
+
+class GTO_API Arena
+{
+public:
+    explicit Arena(size_t slabSize = 1 << 20);
+    ~Arena();
+
+    //
+    //  Make sure the next allocations totalling bytes (each rounded
+    //  up to 16) come from a single slab.
+    //
+
+    void            reserve(size_t bytes);
+
+    void*           allocate(size_t bytes);
+    void            clear();
+
+    size_t          bytesUsed() const { return m_used; }
+    size_t          numSlabs() const { return m_slabs.size(); }
+
+    static size_t   roundUp(size_t bytes) { return (bytes + 15) & ~size_t(15); }
+
+private:
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    void            newSlab(size_t bytes);
+
+    std::vector<char*> m_slabs;
+    char*           m_next;
+    size_t          m_left;
+    size_t          m_slabSize;
+    size_t          m_used;
+};
+
+} // Gto
+
+#endif // __Gto__Arena__h__
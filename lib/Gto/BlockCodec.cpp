@@ -0,0 +1,332 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#ifdef GTO_SUPPORT_ZIP
+
+#include "BlockCodec.h"
+#include <zlib.h>
+#include <string.h>
+#ifdef GTO_SUPPORT_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef GTO_SUPPORT_ZSTD
+#include <zstd.h>
+#endif
+
+namespace Gto {
+using namespace std;
+
+//----------------------------------------------------------------------
+//
+//  gzip: every block is a gzip member. Metadata is an empty member
+//  whose FEXTRA field holds a single 'G',id subfield.
+//
+
+class GzipCodec : public BlockCodec
+{
+public:
+    virtual const char* name() const { return "gzip"; }
+
+    virtual bool compress(const vector<char>& in, vector<char>& out, 
+                          int level) const
+    {
+        z_stream z;
+        memset(&z, 0, sizeof(z));
+
+        if (deflateInit2(&z, level < 0 ? Z_DEFAULT_COMPRESSION : level,
+                         Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return false;
+        }
+
+        out.resize(deflateBound(&z, uLong(in.size())));
+
+        z.next_in   = (Bytef*)&in.front();
+        z.avail_in  = uInt(in.size());
+        z.next_out  = (Bytef*)&out.front();
+        z.avail_out = uInt(out.size());
+
+        int r = deflate(&z, Z_FINISH);
+        out.resize(size_t(z.total_out));
+        deflateEnd(&z);
+
+        return r == Z_STREAM_END;
+    }
+
+    virtual bool decompress(const unsigned char* in, size_t inSize,
+                            char* out, size_t outSize) const
+    {
+        if (inSize > 0xffffffffu || outSize > 0xffffffffu) return false;
+
+        z_stream z;
+        memset(&z, 0, sizeof(z));
+        if (inflateInit2(&z, 15 + 16) != Z_OK) return false;
+
+        z.next_in   = (Bytef*)in;
+        z.avail_in  = uInt(inSize);
+        z.next_out  = (Bytef*)out;
+        z.avail_out = uInt(outSize);
+
+        int r = inflate(&z, Z_FINISH);
+        bool ok = r == Z_STREAM_END && z.total_out == outSize;
+        inflateEnd(&z);
+        return ok;
+    }
+
+    virtual size_t metadataHeaderSize() const { return 16; }
+    virtual size_t metadataTrailerSize() const { return 10; }
+
+    virtual void metadataHeader(char id, size_t size, unsigned char* h) const
+    {
+        size_t xlen = size + 4;
+        const unsigned char head[10] = 
+            { 0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff };
+
+        memcpy(h, head, sizeof(head));
+        h[10] = (unsigned char)(xlen & 0xff);
+        h[11] = (unsigned char)(xlen >> 8);
+        h[12] = 'G';
+        h[13] = (unsigned char)id;
+        h[14] = (unsigned char)(size & 0xff);
+        h[15] = (unsigned char)(size >> 8);
+    }
+
+    virtual void metadataTrailer(unsigned char* t) const
+    {
+        //
+        //  An empty final deflate block, then CRC32 and ISIZE of nothing
+        //
+
+        memset(t, 0, 10);
+        t[0] = 3;
+    }
+
+    virtual bool parseMetadataHeader(const unsigned char* h, 
+                                     char id,
+                                     size_t& size) const
+    {
+        if (h[0] != 0x1f || h[1] != 0x8b || h[2] != 8 || h[3] != 4) return false;
+
+        size_t xlen = h[10] | (h[11] << 8);
+        size        = h[14] | (h[15] << 8);
+
+        return h[12] == 'G' && h[13] == (unsigned char)id && xlen == size + 4;
+    }
+};
+
+//----------------------------------------------------------------------
+//
+//  LZ4 and Zstd both skip frames with a magic number in 0x184D2A50 -
+//  0x184D2A5F. Metadata is one of those holding 'G',id and the
+//  payload.
+//
+
+static const uint32 SkippableMagic = 0x184D2A5A;
+
+class SkippableFrameCodec : public BlockCodec
+{
+public:
+    virtual size_t metadataHeaderSize() const { return 10; }
+    virtual size_t metadataTrailerSize() const { return 0; }
+
+    virtual void metadataHeader(char id, size_t size, unsigned char* h) const
+    {
+        uint32 frameSize = uint32(size + 2);
+
+        for (int i=0; i < 4; i++)
+        {
+            h[i]     = (unsigned char)(SkippableMagic >> (i * 8));
+            h[i + 4] = (unsigned char)(frameSize >> (i * 8));
+        }
+
+        h[8] = 'G';
+        h[9] = (unsigned char)id;
+    }
+
+    virtual void metadataTrailer(unsigned char*) const {}
+
+    virtual bool parseMetadataHeader(const unsigned char* h, 
+                                     char id,
+                                     size_t& size) const
+    {
+        uint32 magic     = h[0] | (h[1] << 8) | (h[2] << 16) | (uint32(h[3]) << 24);
+        uint32 frameSize = h[4] | (h[5] << 8) | (h[6] << 16) | (uint32(h[7]) << 24);
+
+        if (magic != SkippableMagic || frameSize < 2) return false;
+        size = frameSize - 2;
+        return h[8] == 'G' && h[9] == (unsigned char)id;
+    }
+};
+
+#ifdef GTO_SUPPORT_LZ4
+class LZ4Codec : public SkippableFrameCodec
+{
+public:
+    virtual const char* name() const { return "lz4"; }
+
+    virtual bool compress(const vector<char>& in, vector<char>& out, 
+                          int level) const
+    {
+        LZ4F_preferences_t prefs;
+        memset(&prefs, 0, sizeof(prefs));
+        prefs.frameInfo.contentSize = in.size();
+        prefs.compressionLevel      = level < 0 ? 0 : level;
+
+        out.resize(LZ4F_compressFrameBound(in.size(), &prefs));
+        size_t r = LZ4F_compressFrame(&out.front(), out.size(), 
+                                      &in.front(), in.size(), &prefs);
+
+        if (LZ4F_isError(r)) return false;
+        out.resize(r);
+        return true;
+    }
+
+    virtual bool decompress(const unsigned char* in, size_t inSize,
+                            char* out, size_t outSize) const
+    {
+        LZ4F_dctx* ctx = 0;
+
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION)))
+        {
+            return false;
+        }
+
+        size_t produced = 0;
+        size_t consumed = 0;
+        size_t r        = 1;
+
+        while (r != 0 && consumed < inSize)
+        {
+            size_t dstSize = outSize - produced;
+            size_t srcSize = inSize - consumed;
+
+            r = LZ4F_decompress(ctx, out + produced, &dstSize,
+                                in + consumed, &srcSize, 0);
+
+            if (LZ4F_isError(r) || (dstSize == 0 && srcSize == 0)) break;
+
+            produced += dstSize;
+            consumed += srcSize;
+        }
+
+        LZ4F_freeDecompressionContext(ctx);
+        return r == 0 && produced == outSize;
+    }
+};
+#endif
+
+#ifdef GTO_SUPPORT_ZSTD
+class ZstdCodec : public SkippableFrameCodec
+{
+public:
+    virtual const char* name() const { return "zstd"; }
+
+    virtual bool compress(const vector<char>& in, vector<char>& out, 
+                          int level) const
+    {
+        out.resize(ZSTD_compressBound(in.size()));
+        size_t r = ZSTD_compress(&out.front(), out.size(), 
+                                 &in.front(), in.size(), 
+                                 level < 0 ? 3 : level);
+
+        if (ZSTD_isError(r)) return false;
+        out.resize(r);
+        return true;
+    }
+
+    virtual bool decompress(const unsigned char* in, size_t inSize,
+                            char* out, size_t outSize) const
+    {
+        size_t r = ZSTD_decompress(out, outSize, in, inSize);
+        return !ZSTD_isError(r) && r == outSize;
+    }
+};
+#endif
+
+//----------------------------------------------------------------------
+
+const BlockCodec*
+BlockCodec::find(BlockCodecType type)
+{
+    static GzipCodec gzip;
+#ifdef GTO_SUPPORT_LZ4
+    static LZ4Codec lz4;
+#endif
+#ifdef GTO_SUPPORT_ZSTD
+    static ZstdCodec zstd;
+#endif
+
+    switch (type)
+    {
+      case GzipBlocks: return &gzip;
+#ifdef GTO_SUPPORT_LZ4
+      case LZ4Blocks:  return &lz4;
+#endif
+#ifdef GTO_SUPPORT_ZSTD
+      case ZstdBlocks: return &zstd;
+#endif
+      default:         return 0;
+    }
+}
+
+const BlockCodec*
+BlockCodec::detect(const unsigned char* m, const char*& name)
+{
+    uint32 magic = m[0] | (m[1] << 8) | (m[2] << 16) | (uint32(m[3]) << 24);
+
+    if (m[0] == 0x1f && m[1] == 0x8b)
+    {
+        name = "gzip";
+        return find(GzipBlocks);
+    }
+    else if (magic == 0x184D2204)
+    {
+        name = "lz4";
+        return find(LZ4Blocks);
+    }
+    else if (magic == 0xFD2FB528)
+    {
+        name = "zstd";
+        return find(ZstdBlocks);
+    }
+
+    name = 0;
+    return 0;
+}
+
+} // Gto
+
+#endif // GTO_SUPPORT_ZIP
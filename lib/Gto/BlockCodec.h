@@ -0,0 +1,113 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+#ifndef __Gto__BlockCodec__h__
+#define __Gto__BlockCodec__h__
+
+#include <Gto/Header.h>
+#include <stddef.h>
+#include <vector>
+
+namespace Gto {
+
+//
+//  Compressors for the blocks of a block compressed file (see
+//  BlockFile.h). gzip is always available when the library is built
+//  with zlib; LZ4 and Zstd when built with GTO_SUPPORT_LZ4 and
+//  GTO_SUPPORT_ZSTD. The codec of a file is recognized from its first
+//  four bytes, which are the magic number of the first block.
+//
+//  Besides data blocks each codec can write "metadata" frames which
+//  carry the index and footer and which the codec's own command line
+//  tool decompresses to nothing: empty gzip members with an extra
+//  field for gzip, skippable frames for LZ4 and Zstd.
+//
+
+enum BlockCodecType
+{
+    GzipBlocks,
+    LZ4Blocks,
+    ZstdBlocks
+};
+
+class BlockCodec
+{
+public:
+    virtual ~BlockCodec() {}
+
+    //
+    //  Returns 0 if the library was built without the codec. detect()
+    //  sets name for any known magic number even when it returns 0 so
+    //  the caller can say what's missing.
+    //
+
+    static const BlockCodec* find(BlockCodecType);
+    static const BlockCodec* detect(const unsigned char* magic, 
+                                    const char*& name);
+
+    virtual const char* name() const = 0;
+
+    //
+    //  A negative level means the codec's default.
+    //
+
+    virtual bool    compress(const std::vector<char>& in,
+                             std::vector<char>& out,
+                             int level) const = 0;
+
+    virtual bool    decompress(const unsigned char* in, size_t inSize,
+                               char* out, size_t outSize) const = 0;
+
+    //
+    //  Metadata frames: header, payload, trailer. The id is one
+    //  character ('I' index, 'T' footer). payloadSize must be less
+    //  than 64k.
+    //
+
+    virtual size_t  metadataHeaderSize() const = 0;
+    virtual size_t  metadataTrailerSize() const = 0;
+
+    virtual void    metadataHeader(char id, size_t payloadSize, 
+                                   unsigned char* header) const = 0;
+    virtual void    metadataTrailer(unsigned char* trailer) const = 0;
+
+    virtual bool    parseMetadataHeader(const unsigned char* header, 
+                                        char id,
+                                        size_t& payloadSize) const = 0;
+};
+
+} // Gto
+
+#endif // __Gto__BlockCodec__h__
@@ -0,0 +1,581 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#ifdef GTO_SUPPORT_ZIP
+
+#include "BlockFile.h"
+#include <string.h>
+#include <algorithm>
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Gto {
+using namespace std;
+
+//
+//  The container is byte order independent: everything in the index
+//  and footer is little-endian.
+//
+
+static void
+putLE64(unsigned char* p, uint64 v)
+{
+    for (int i=0; i < 8; i++) p[i] = (unsigned char)(v >> (i * 8));
+}
+
+static uint64
+getLE64(const unsigned char* p)
+{
+    uint64 v = 0;
+    for (int i=7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+//----------------------------------------------------------------------
+
+BlockReader::BlockReader()
+    : m_codec(0),
+      m_missingCodec(0),
+      m_blockIndex(size_t(-1)),
+      m_pos(0)
+{
+}
+
+BlockReader::~BlockReader()
+{
+    close();
+}
+
+bool
+BlockReader::open(const char* filename)
+{
+    close();
+
+    unsigned char magic[4];
+
+    if (!m_file.open(filename) || 
+        !m_file.read(0, magic, sizeof(magic)) ||
+        !(m_codec = BlockCodec::detect(magic, m_missingCodec)) ||
+        !readIndex())
+    {
+        const char* missing = m_codec ? 0 : m_missingCodec;
+        close();
+        m_missingCodec = missing;
+        return false;
+    }
+
+    return true;
+}
+
+void
+BlockReader::close()
+{
+    m_file.close();
+    m_codec        = 0;
+    m_missingCodec = 0;
+    m_coffsets.clear();
+    m_uoffsets.clear();
+    m_block.clear();
+    m_blockIndex = size_t(-1);
+    m_pos        = 0;
+}
+
+bool
+BlockReader::readIndex()
+{
+    size_t headerSize  = m_codec->metadataHeaderSize();
+    size_t trailerSize = m_codec->metadataTrailerSize();
+    size_t footerSize  = headerSize + FooterPayloadSize + trailerSize;
+    uint64 fileSize    = m_file.size();
+
+    if (fileSize < footerSize) return false;
+
+    vector<unsigned char> footer(footerSize);
+    size_t len = 0;
+
+    if (!m_file.read(fileSize - footerSize, &footer.front(), footerSize) ||
+        !m_codec->parseMetadataHeader(&footer.front(), 'T', len) ||
+        len != FooterPayloadSize)
+    {
+        return false;
+    }
+
+    uint64 indexOffset = getLE64(&footer[headerSize]);
+    uint64 numBlocks   = getLE64(&footer[headerSize + 8]);
+    uint64 total       = getLE64(&footer[headerSize + 16]);
+    uint64 indexEnd    = fileSize - footerSize;
+
+    //
+    //  Every block is at least a few bytes of framing
+    //
+
+    if (indexOffset > indexEnd || numBlocks > indexOffset / 8) return false;
+
+    m_coffsets.reserve(size_t(numBlocks) + 1);
+    m_uoffsets.reserve(size_t(numBlocks) + 1);
+
+    vector<unsigned char> header(headerSize);
+    vector<unsigned char> payload;
+    uint64 offset = indexOffset;
+
+    while (m_coffsets.size() < numBlocks)
+    {
+        if (offset + headerSize > indexEnd ||
+            !m_file.read(offset, &header.front(), headerSize) ||
+            !m_codec->parseMetadataHeader(&header.front(), 'I', len) ||
+            len % 16 != 0 || len == 0 ||
+            offset + headerSize + len > indexEnd)
+        {
+            return false;
+        }
+
+        payload.resize(len);
+
+        if (!m_file.read(offset + headerSize, &payload.front(), len))
+        {
+            return false;
+        }
+
+        for (size_t i=0; i < len && m_coffsets.size() < numBlocks; i += 16)
+        {
+            m_coffsets.push_back(getLE64(&payload[i]));
+            m_uoffsets.push_back(getLE64(&payload[i + 8]));
+        }
+
+        offset += headerSize + len + trailerSize;
+    }
+
+    m_coffsets.push_back(indexOffset);
+    m_uoffsets.push_back(total);
+
+    //
+    //  Blocks are contiguous, non-empty and start at zero
+    //
+
+    for (size_t i=0; i < m_coffsets.size() - 1; i++)
+    {
+        if (m_coffsets[i] >= m_coffsets[i+1] || 
+            m_uoffsets[i] >= m_uoffsets[i+1])
+        {
+            return false;
+        }
+    }
+
+    return numBlocks == 0 || (m_coffsets[0] == 0 && m_uoffsets[0] == 0);
+}
+
+size_t
+BlockReader::findBlock(uint64 offset) const
+{
+    return size_t(upper_bound(m_uoffsets.begin(), m_uoffsets.end(), offset) - 
+                  m_uoffsets.begin()) - 1;
+}
+
+bool
+BlockReader::inflateBlock(size_t block, char* out) const
+{
+    uint64 csize = m_coffsets[block+1] - m_coffsets[block];
+    uint64 usize = m_uoffsets[block+1] - m_uoffsets[block];
+
+    if (csize > 0xffffffffu || usize > 0xffffffffu) return false;
+
+    vector<unsigned char> in;
+    in.resize(size_t(csize));
+
+    return m_file.read(m_coffsets[block], &in.front(), in.size()) &&
+           m_codec->decompress(&in.front(), in.size(), out, size_t(usize));
+}
+
+uint64
+BlockReader::blockEnd(uint64 offset) const
+{
+    if (offset >= size()) return size();
+    return m_uoffsets[findBlock(offset) + 1];
+}
+
+bool
+BlockReader::readAt(uint64 offset, 
+                    void* buffer, 
+                    size_t bytes,
+                    BlockCursor* cursor) const
+{
+    if (offset > size() || bytes > size() - offset) return false;
+
+    char* out = (char*)buffer;
+    BlockCursor temp;
+    if (!cursor) cursor = &temp;
+
+    while (bytes)
+    {
+        size_t block = findBlock(offset);
+        uint64 begin = m_uoffsets[block];
+        size_t usize = size_t(m_uoffsets[block+1] - begin);
+        size_t skip  = size_t(offset - begin);
+        size_t n     = min(bytes, usize - skip);
+
+        if (cursor->block == block)
+        {
+            memcpy(out, &cursor->data[skip], n);
+        }
+        else if (n == usize)
+        {
+            if (!inflateBlock(block, out)) return false;
+        }
+        else
+        {
+            cursor->data.resize(usize);
+
+            if (!inflateBlock(block, &cursor->data.front()))
+            {
+                cursor->block = size_t(-1);
+                return false;
+            }
+
+            cursor->block = block;
+            memcpy(out, &cursor->data[skip], n);
+        }
+
+        out    += n;
+        offset += n;
+        bytes  -= n;
+    }
+
+    return true;
+}
+
+size_t
+BlockReader::read(void* buffer, size_t bytes)
+{
+    char* out    = (char*)buffer;
+    size_t total = 0;
+
+    while (bytes && m_pos < size())
+    {
+        size_t block = findBlock(m_pos);
+        uint64 begin = m_uoffsets[block];
+        size_t usize = size_t(m_uoffsets[block+1] - begin);
+
+        if (block != m_blockIndex)
+        {
+            //
+            //  Whole blocks go straight into the caller's buffer
+            //
+
+            if (m_pos == begin && bytes >= usize)
+            {
+                if (!inflateBlock(block, out)) break;
+                out   += usize;
+                total += usize;
+                bytes -= usize;
+                m_pos += usize;
+                continue;
+            }
+
+            m_block.resize(usize);
+
+            if (!inflateBlock(block, &m_block.front()))
+            {
+                m_blockIndex = size_t(-1);
+                break;
+            }
+
+            m_blockIndex = block;
+        }
+
+        size_t skip = size_t(m_pos - begin);
+        size_t n    = min(bytes, usize - skip);
+        memcpy(out, &m_block[skip], n);
+
+        out   += n;
+        total += n;
+        bytes -= n;
+        m_pos += n;
+    }
+
+    return total;
+}
+
+//----------------------------------------------------------------------
+
+BlockWriter::BlockWriter(int fd, 
+                         const BlockCodec* codec,
+                         int level, 
+                         unsigned int threadCount)
+    : m_fd(fd),
+      m_codec(codec),
+      m_level(level),
+      m_coffset(0),
+      m_uoffset(0),
+      m_stop(false)
+{
+    m_block.reserve(BlockSize);
+
+    for (unsigned int i=0; threadCount > 1 && i < threadCount; i++)
+    {
+        m_threads.push_back(std::thread(&BlockWriter::compressLoop, this));
+    }
+}
+
+BlockWriter::~BlockWriter()
+{
+    stopThreads();
+
+    for (size_t i=0; i < m_pending.size(); i++) delete m_pending[i];
+}
+
+void
+BlockWriter::stopThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for (size_t i=0; i < m_threads.size(); i++) m_threads[i].join();
+    m_threads.clear();
+}
+
+void
+BlockWriter::compressLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (;;)
+    {
+        while (m_todo.empty() && !m_stop) m_wake.wait(lock);
+        if (m_todo.empty()) return;
+
+        Job* job = m_todo.front();
+        m_todo.pop_front();
+
+        lock.unlock();
+        bool ok = m_codec->compress(job->in, job->out, m_level);
+        lock.lock();
+
+        job->ok   = ok;
+        job->done = true;
+        m_done.notify_all();
+    }
+}
+
+bool
+BlockWriter::write(const void* data, size_t bytes)
+{
+    const char* p = (const char*)data;
+
+    while (bytes)
+    {
+        size_t n = min(bytes, size_t(BlockSize) - m_block.size());
+        m_block.insert(m_block.end(), p, p + n);
+        p     += n;
+        bytes -= n;
+
+        if (m_block.size() == size_t(BlockSize) && !flushBlock()) return false;
+    }
+
+    return true;
+}
+
+bool
+BlockWriter::startBlock()
+{
+    return m_block.size() < size_t(MinBlockSize) || flushBlock();
+}
+
+bool
+BlockWriter::flushBlock()
+{
+    if (m_block.empty()) return true;
+
+    Job* job  = new Job;
+    job->done = false;
+    job->ok   = false;
+    job->in.swap(m_block);
+    m_block.reserve(BlockSize);
+
+    if (m_threads.empty())
+    {
+        job->ok   = m_codec->compress(job->in, job->out, m_level);
+        job->done = true;
+        return writeJob(job);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_todo.push_back(job);
+        m_pending.push_back(job);
+    }
+
+    m_wake.notify_one();
+    return writeJobs(false);
+}
+
+//
+//  Writes finished blocks from the front of the queue. Waits for the
+//  oldest block if too many are in flight or if all is true.
+//
+
+bool
+BlockWriter::writeJobs(bool all)
+{
+    size_t maxPending = all ? 0 : m_threads.size() * 2;
+
+    for (;;)
+    {
+        Job* job = 0;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_pending.empty()) return true;
+
+            while (!m_pending.front()->done && m_pending.size() > maxPending)
+            {
+                m_done.wait(lock);
+            }
+
+            if (!m_pending.front()->done) return true;
+
+            job = m_pending.front();
+            m_pending.pop_front();
+        }
+
+        if (!writeJob(job)) return false;
+    }
+}
+
+bool
+BlockWriter::writeJob(Job* job)
+{
+    bool ok = job->ok;
+
+    if (ok)
+    {
+        m_index.push_back(m_coffset);
+        m_index.push_back(m_uoffset);
+        m_coffset += job->out.size();
+        m_uoffset += job->in.size();
+        ok = writeRaw(&job->out.front(), job->out.size());
+    }
+
+    delete job;
+    return ok;
+}
+
+bool
+BlockWriter::finish()
+{
+    if (!flushBlock() || !writeJobs(true)) return false;
+    stopThreads();
+
+    uint64 indexOffset = m_coffset;
+    size_t numBlocks   = m_index.size() / 2;
+    vector<unsigned char> payload;
+
+    for (size_t i=0; i < numBlocks; i += IndexEntriesPerMember)
+    {
+        size_t n = min(numBlocks - i, size_t(IndexEntriesPerMember));
+        payload.resize(n * 16);
+
+        for (size_t q=0; q < n * 2; q++)
+        {
+            putLE64(&payload[q * 8], m_index[i * 2 + q]);
+        }
+
+        if (!writeMetadata('I', &payload.front(), payload.size()))
+        {
+            return false;
+        }
+    }
+
+    unsigned char footer[FooterPayloadSize];
+    putLE64(footer, indexOffset);
+    putLE64(footer + 8, uint64(numBlocks));
+    putLE64(footer + 16, m_uoffset);
+
+    return writeMetadata('T', footer, FooterPayloadSize);
+}
+
+bool
+BlockWriter::writeMetadata(char id, const unsigned char* payload, size_t size)
+{
+    vector<unsigned char> frame(m_codec->metadataHeaderSize() + size +
+                                m_codec->metadataTrailerSize());
+
+    unsigned char* p = &frame.front();
+
+    m_codec->metadataHeader(id, size, p);
+    memcpy(p + m_codec->metadataHeaderSize(), payload, size);
+    m_codec->metadataTrailer(p + m_codec->metadataHeaderSize() + size);
+
+    if (!writeRaw(&frame.front(), frame.size())) return false;
+
+    m_coffset += frame.size();
+    return true;
+}
+
+bool
+BlockWriter::writeRaw(const void* data, size_t bytes)
+{
+    const char* p = (const char*)data;
+
+    while (bytes)
+    {
+        unsigned int chunk = bytes > (1u << 30) ? (1u << 30) : unsigned(bytes);
+#ifdef _WIN32
+        int n = ::_write(m_fd, p, chunk);
+#else
+        ssize_t n = ::write(m_fd, p, chunk);
+#endif
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+
+        p     += n;
+        bytes -= size_t(n);
+    }
+
+    return true;
+}
+
+} // Gto
+
+#endif // GTO_SUPPORT_ZIP
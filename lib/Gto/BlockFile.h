@@ -0,0 +1,226 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+#ifndef __Gto__BlockFile__h__
+#define __Gto__BlockFile__h__
+
+#include <Gto/Header.h>
+#include "PositionalFile.h"
+#include "BlockCodec.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Gto {
+
+//
+//  Block compressed container
+//
+//  A compressed GTO file is written as a sequence of independently
+//  compressed gzip members, LZ4 frames or Zstd frames ("blocks", see
+//  BlockCodec.h). Each block holds at most BlockSize bytes of the
+//  uncompressed GTO stream, and property data always starts a new
+//  block unless the current one is still small. Because concatenated
+//  members/frames are themselves valid, gunzip (or lz4, zstd) and
+//  older readers see the ordinary GTO stream.
+//
+//  After the last block come one or more metadata frames with id 'I'
+//  holding the block index: pairs of little-endian uint64 (compressed
+//  offset, uncompressed offset). The file ends with a fixed size
+//  metadata frame (id 'T') holding the compressed offset of the
+//  index, the number of blocks and the uncompressed size. Readers
+//  find the footer by looking at the end of the file.
+//
+
+enum BlockFileConstants
+{
+    BlockSize           = 1 << 20,
+    MinBlockSize        = 1 << 16,
+    IndexEntriesPerMember = 4095,
+    FooterPayloadSize   = 3 * 8
+};
+
+//
+//  class BlockCursor
+//
+//  The last block inflated by the BlockReader::readAt() calls it is
+//  passed to. A series of reads from one thread that share a cursor
+//  inflate each block at most once as long as they move forward.
+//
+
+class BlockCursor
+{
+public:
+    BlockCursor() : block(size_t(-1)) {}
+
+    size_t              block;
+    std::vector<char>   data;
+};
+
+//
+//  class BlockReader
+//
+//  Random access into a block compressed file. readAt() is const and
+//  thread safe (with a BlockCursor per thread). read()/seek() keep a
+//  cursor and the current block decompressed for the Reader's
+//  sequential parsing.
+//
+
+class BlockReader
+{
+public:
+    BlockReader();
+    ~BlockReader();
+
+    //
+    //  Returns false if the file is not a block compressed file.
+    //  missingCodec() is the name of the codec if the file looked
+    //  like a compressed file this library can't decompress.
+    //
+
+    bool        open(const char* filename);
+    const char* missingCodec() const { return m_missingCodec; }
+    void        close();
+
+    uint64      size() const { return m_uoffsets.empty() ? 0 : m_uoffsets.back(); }
+    size_t      numBlocks() const { return m_coffsets.empty() ? 0 : m_coffsets.size() - 1; }
+
+    bool        readAt(uint64 offset, void* buffer, size_t bytes,
+                       BlockCursor* cursor = 0) const;
+
+    //  Uncompressed offset of the end of the block holding offset
+    uint64      blockEnd(uint64 offset) const;
+
+    size_t      read(void* buffer, size_t bytes);
+    void        seek(uint64 offset) { m_pos = offset; }
+    uint64      tell() const { return m_pos; }
+    bool        eof() const { return m_pos >= size(); }
+
+private:
+    BlockReader(const BlockReader&);
+    BlockReader& operator=(const BlockReader&);
+
+    bool        readIndex();
+    size_t      findBlock(uint64 offset) const;
+    bool        inflateBlock(size_t block, char* out) const;
+
+private:
+    PositionalFile      m_file;
+    const BlockCodec*   m_codec;
+    const char*         m_missingCodec;
+    std::vector<uint64> m_coffsets;     // numBlocks + 1, last is the index
+    std::vector<uint64> m_uoffsets;     // numBlocks + 1, last is the size
+    std::vector<char>   m_block;
+    size_t              m_blockIndex;
+    uint64              m_pos;
+};
+
+//
+//  class BlockWriter
+//
+//  Buffers the uncompressed stream and writes it as blocks to a file
+//  descriptor. finish() writes the last block, the index and the
+//  footer. Returns false from write()/finish() if the file could not
+//  be written.
+//
+//  With more than one thread, full blocks are handed to a pool of
+//  compression threads and written in order as they complete; at most
+//  two blocks per thread are in flight. The output is identical to
+//  the single threaded output.
+//
+
+class BlockWriter
+{
+public:
+    BlockWriter(int fd, 
+                const BlockCodec* codec,
+                int level = -1, 
+                unsigned int threadCount = 1);
+    ~BlockWriter();
+
+    bool        write(const void* data, size_t bytes);
+
+    //
+    //  Start a new block at the current position unless the pending
+    //  one holds less than MinBlockSize bytes.
+    //
+
+    bool        startBlock();
+
+    bool        finish();
+
+private:
+    BlockWriter(const BlockWriter&);
+    BlockWriter& operator=(const BlockWriter&);
+
+    struct Job
+    {
+        std::vector<char>   in;
+        std::vector<char>   out;
+        bool                done;
+        bool                ok;
+    };
+
+    bool        flushBlock();
+    bool        writeJobs(bool all);
+    bool        writeJob(Job*);
+    void        stopThreads();
+    void        compressLoop();
+    bool        writeRaw(const void*, size_t);
+    bool        writeMetadata(char id, const unsigned char* payload, 
+                              size_t size);
+
+private:
+    int                         m_fd;
+    const BlockCodec*           m_codec;
+    int                         m_level;
+    std::vector<char>           m_block;
+    std::vector<uint64>         m_index;    // (coffset, uoffset) pairs
+    uint64                      m_coffset;
+    uint64                      m_uoffset;
+    std::vector<std::thread>    m_threads;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wake;     // new job or stop
+    std::condition_variable     m_done;     // a job finished
+    std::deque<Job*>            m_todo;     // not yet compressed
+    std::deque<Job*>            m_pending;  // not yet written, in order
+    bool                        m_stop;
+};
+
+} // Gto
+
+#endif // __Gto__BlockFile__h__
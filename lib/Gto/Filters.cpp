@@ -0,0 +1,170 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#include "Filters.h"
+#include <string.h>
+
+namespace Gto {
+
+void
+shuffleBytes(const void* in, void* out, size_t num, size_t size)
+{
+    const unsigned char* src = (const unsigned char*)in;
+    unsigned char* dst       = (unsigned char*)out;
+
+    for (size_t b=0; b < size; b++)
+    {
+        unsigned char* plane = dst + b * num;
+        for (size_t i=0; i < num; i++) plane[i] = src[i * size + b];
+    }
+}
+
+void
+unshuffleBytes(const void* in, void* out, size_t num, size_t size)
+{
+    const unsigned char* src = (const unsigned char*)in;
+    unsigned char* dst       = (unsigned char*)out;
+
+    for (size_t b=0; b < size; b++)
+    {
+        const unsigned char* plane = src + b * num;
+        for (size_t i=0; i < num; i++) dst[i * size + b] = plane[i];
+    }
+}
+
+//
+//  Deltas are taken between the same value of neighboring elements
+//  using unsigned (wrapping) arithmetic so they are exact for any bit
+//  pattern, floats included.
+//
+
+template <typename T>
+static void
+deltaEncodeT(T* p, size_t num, size_t width)
+{
+    for (size_t i=num; i-- > width;) p[i] = T(p[i] - p[i - width]);
+}
+
+template <typename T>
+static void
+deltaDecodeT(T* p, size_t num, size_t width)
+{
+    for (size_t i=width; i < num; i++) p[i] = T(p[i] + p[i - width]);
+}
+
+void
+deltaEncode(void* data, size_t num, size_t width, size_t size)
+{
+    if (!width) return;
+
+    switch (size)
+    {
+      case 1: deltaEncodeT((uint8*)data, num, width); break;
+      case 2: deltaEncodeT((uint16*)data, num, width); break;
+      case 4: deltaEncodeT((uint32*)data, num, width); break;
+      case 8: deltaEncodeT((uint64*)data, num, width); break;
+    }
+}
+
+void
+deltaDecode(void* data, size_t num, size_t width, size_t size)
+{
+    if (!width) return;
+
+    switch (size)
+    {
+      case 1: deltaDecodeT((uint8*)data, num, width); break;
+      case 2: deltaDecodeT((uint16*)data, num, width); break;
+      case 4: deltaDecodeT((uint32*)data, num, width); break;
+      case 8: deltaDecodeT((uint64*)data, num, width); break;
+    }
+}
+
+//
+//  Round to nearest by adding half of the dropped bits. A carry into
+//  the exponent is correct rounding unless it would make an infinity,
+//  in which case the value is truncated instead. NaN and infinity are
+//  left alone.
+//
+
+void
+quantizeFloats(float32* data, size_t num, int mantissaBits)
+{
+    if (mantissaBits < 0 || mantissaBits >= 23) return;
+
+    int    drop = 23 - mantissaBits;
+    uint32 mask = ~((uint32(1) << drop) - 1);
+    uint32 half = uint32(1) << (drop - 1);
+
+    for (size_t i=0; i < num; i++)
+    {
+        uint32 b;
+        memcpy(&b, data + i, sizeof(b));
+
+        if ((b & 0x7f800000) == 0x7f800000) continue;
+
+        uint32 r = (b + half) & mask;
+        if ((r & 0x7f800000) == 0x7f800000) r = b & mask;
+
+        memcpy(data + i, &r, sizeof(r));
+    }
+}
+
+void
+quantizeDoubles(float64* data, size_t num, int mantissaBits)
+{
+    if (mantissaBits < 0 || mantissaBits >= 52) return;
+
+    const uint64 expMask = 0x7ff0000000000000ULL;
+    int    drop = 52 - mantissaBits;
+    uint64 mask = ~((uint64(1) << drop) - 1);
+    uint64 half = uint64(1) << (drop - 1);
+
+    for (size_t i=0; i < num; i++)
+    {
+        uint64 b;
+        memcpy(&b, data + i, sizeof(b));
+
+        if ((b & expMask) == expMask) continue;
+
+        uint64 r = (b + half) & mask;
+        if ((r & expMask) == expMask) r = b & mask;
+
+        memcpy(data + i, &r, sizeof(r));
+    }
+}
+
+} // Gto
@@ -1,12 +1,3 @@
-
-#ifndef __ZHACKS_H__
-#define __ZHACKS_H__
-
-#ifdef GTO_SUPPORT_ZIP
-
-#include <stdio.h>
-#include <zlib.h>
-
 //
 //  Copyright (c) 2009, Tweak Software
 //  All rights reserved.
@@ -42,36 +33,38 @@
 //  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
 //  DAMAGE.
 //
+#ifndef __Gto__Filters__h__
+#define __Gto__Filters__h__
 
-#define EXTRA_FIELD  0x04 /* bit 2 set: extra field present */
+#include <Gto/Header.h>
+#include <stddef.h>
 
+namespace Gto {
 
 //
-// Seek directly to a flush point in a gz file.  Also resets
-// the decompressor.  No checking is done to make sure there
-// is actually a flush point at the given offset.
+//  Property filters (see PropertyFilter in Header.h). The writer
+//  applies delta then shuffle to a copy of the property data in its
+//  native byte order; the reader undoes the shuffle, byte swaps if
+//  needed and then undoes the delta.
 //
-z_off_t gzseek_raw(gzFile file, z_off_t raw_offset);
+//  num is the number of atomic values, size the size of one value
+//  (1, 2, 4 or 8 bytes) and width the number of values per element.
+//
+
+void    shuffleBytes(const void* in, void* out, size_t num, size_t size);
+void    unshuffleBytes(const void* in, void* out, size_t num, size_t size);
 
+void    deltaEncode(void* data, size_t num, size_t width, size_t size);
+void    deltaDecode(void* data, size_t num, size_t width, size_t size);
 
 //
-// We need to access some fields from a zlib gz_stream through an opaque
-// pointer, so we roll our own.  In this instance, "GTO" is properly
-// pronounced "ghetto".
+//  Lossy: rounds the mantissa of each value to the given number of
+//  bits. The result is still plain float data.
 //
-typedef struct gz_stream {
-    z_stream gto_stream;
-    int      gto_z_err, gto_z_eof;
-    FILE     *gto_z_file;
-    Byte     *gto_inbuf, *__foo2;
-    uLong    gto_crc;
-    char     *__foo3, *__foo4;
-    int       __foo0;
-    char     gto_mode;
-    z_off_t  gto_start, gto_in, gto_out;
-    int      gto_back, gto_last;
-} gz_stream;
 
-#endif
+void    quantizeFloats(float32* data, size_t num, int mantissaBits);
+void    quantizeDoubles(float64* data, size_t num, int mantissaBits);
+
+} // Gto
 
-#endif    // End #ifdef __ZHACKS_H__
+#endif // __Gto__Filters__h__
@@ -55,9 +55,12 @@ namespace Gto {
 #define GTO_MAGIC_TEXT  0x47544f61
 #define GTO_MAGIC_TEXTl 0x614f5447
 #define GTO_VERSION     3
+#define GTO_VERSION_FILTERED 4     // written when a property has filters
+#define GTO_VERSION_STREAMED 5     // description follows the data
 
 typedef unsigned int        uint32;
 typedef int                 int32;
+typedef unsigned long long  uint64;
 typedef unsigned short      uint16;
 typedef unsigned char       uint8;
 typedef float               float32;
@@ -81,6 +84,21 @@ struct GTO_API Header
     uint32        flags;                    // undetermined;
 };
 
+//
+//  Streamed files start with a Header of version GTO_VERSION_STREAMED
+//  with no strings or objects and the property data right after
+//  it. The description follows the data, laid out as in an ordinary
+//  file (its own Header, string table, objects, components and
+//  properties), and the file ends with a StreamFooter.
+//
+
+struct GTO_API StreamFooter
+{
+    uint64        descriptionOffset;
+    uint32        magic;
+    uint32        pad;
+};
+
 //
 //  Object Header
 //
@@ -147,6 +165,17 @@ enum DataType
     ErrorType
 };
 
+//
+//  Lossless transforms applied to a property's data before it is
+//  written (and compressed). Stored in PropertyHeader::pad. Files
+//  using them are written as version 4.
+//
+
+enum PropertyFilter
+{
+    ShuffleFilter   = 1 << 0,   // group the n-th byte of every value
+    DeltaFilter     = 1 << 1,   // difference from the previous element
+};
 
 struct GTO_API PropertyHeader
 {
@@ -155,7 +184,7 @@ struct GTO_API PropertyHeader
     uint32        type;
     uint32        width;
     uint32        interpretation;   // string
-    uint32        pad;
+    uint32        pad;              // PropertyFilter bits (v4)
 };
 
 struct GTO_API PropertyHeader_v2
@@ -0,0 +1,128 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#ifndef __Gto__Parallel__h__
+#define __Gto__Parallel__h__
+
+#include <stddef.h>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace Gto {
+
+//
+//  Number of threads to use when the caller passes 0
+//
+
+inline unsigned int
+defaultThreadCount()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+//
+//  Calls f(i) for every i in [0, count). Work is handed out one index
+//  at a time to up to nthreads threads (the calling thread is one of
+//  them), so uneven items balance themselves. f must be safe to call
+//  concurrently. If f throws, no more items are started and the
+//  exception (one of them, if several threads threw) is rethrown on
+//  the calling thread once all threads are done.
+//
+
+template <class F>
+void
+parallelFor(size_t count, unsigned int nthreads, F& f)
+{
+    if (nthreads == 0) nthreads = defaultThreadCount();
+    if (nthreads > count) nthreads = (unsigned int)count;
+
+    if (nthreads <= 1)
+    {
+        for (size_t i=0; i < count; i++) f(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> errors(nthreads);
+
+    struct Worker
+    {
+        static void run(std::atomic<size_t>* next, size_t count, F* f,
+                        std::exception_ptr* error)
+        {
+            try
+            {
+                for (size_t i = (*next)++; i < count; i = (*next)++) (*f)(i);
+            }
+            catch (...)
+            {
+                *error = std::current_exception();
+                *next  = count;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned int i=1; i < nthreads; i++)
+    {
+        try
+        {
+            threads.push_back(std::thread(&Worker::run, &next, count, &f,
+                                          &errors[i]));
+        }
+        catch (...)
+        {
+            break;  // fewer threads then
+        }
+    }
+
+    Worker::run(&next, count, &f, &errors[0]);
+
+    for (size_t i=0; i < threads.size(); i++) threads[i].join();
+
+    for (size_t i=0; i < errors.size(); i++)
+    {
+        if (errors[i]) std::rethrow_exception(errors[i]);
+    }
+}
+
+} // Gto
+
+#endif // __Gto__Parallel__h__
@@ -0,0 +1,161 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#include "Pattern.h"
+#include <regex.h>
+#include <string.h>
+
+namespace Gto {
+using namespace std;
+
+//
+//  Glob -> anchored extended regex
+//
+
+static string
+globToRegex(const string& glob)
+{
+    string re = "^";
+
+    for (size_t i=0; i < glob.size(); i++)
+    {
+        char c = glob[i];
+
+        if (c == '*') 
+        {
+            re += ".*";
+        }
+        else if (c == '?') 
+        {
+            re += ".";
+        }
+        else if (c == '[' && glob.find(']', i + 2) != string::npos)
+        {
+            size_t end = glob.find(']', i + 2);
+            re += '[';
+            size_t j = i + 1;
+            if (glob[j] == '!') { re += '^'; j++; }
+            re.append(glob, j, end - j + 1);
+            i = end;
+        }
+        else
+        {
+            if (strchr(".[]()*+?{}|^$\\", c)) re += '\\';
+            re += c;
+        }
+    }
+
+    return re + "$";
+}
+
+Pattern::Pattern() : m_kind(Invalid), m_regex(0) 
+{
+}
+
+Pattern::Pattern(const string& pattern, Syntax syntax) 
+    : m_kind(Invalid), m_regex(0)
+{
+    compile(pattern, syntax);
+}
+
+Pattern::~Pattern()
+{
+    clear();
+}
+
+void
+Pattern::clear()
+{
+    if (m_regex)
+    {
+        regfree((regex_t*)m_regex);
+        delete (regex_t*)m_regex;
+        m_regex = 0;
+    }
+
+    m_kind = Invalid;
+}
+
+bool
+Pattern::compile(const string& pattern, Syntax syntax)
+{
+    clear();
+    m_pattern = pattern;
+
+    //
+    //  Plain names are by far the most common and don't need regexec
+    //
+
+    if (syntax == Glob && pattern.find_first_of("*?[") == string::npos)
+    {
+        m_kind = Exact;
+        return true;
+    }
+
+    if (syntax == Regex && 
+        pattern.find_first_of(".[]()*+?{}|^$\\") == string::npos)
+    {
+        m_kind = Substring;
+        return true;
+    }
+
+    string re = syntax == Glob ? globToRegex(pattern) : pattern;
+    regex_t* e = new regex_t;
+
+    if (regcomp(e, re.c_str(), REG_EXTENDED|REG_NOSUB) != 0)
+    {
+        delete e;
+        return false;
+    }
+
+    m_regex = e;
+    m_kind  = Compiled;
+    return true;
+}
+
+bool
+Pattern::matches(const string& name) const
+{
+    switch (m_kind)
+    {
+      case Exact:       return name == m_pattern;
+      case Substring:   return name.find(m_pattern) != string::npos;
+      case Compiled:    return regexec((regex_t*)m_regex, name.c_str(), 0, 0, 0) == 0;
+      default:          return false;
+    }
+}
+
+} // Gto
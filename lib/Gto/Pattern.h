@@ -0,0 +1,103 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+#ifndef __Gto__Pattern__h__
+#define __Gto__Pattern__h__
+
+#include <Gto/config.h>
+#include <string>
+
+namespace Gto {
+
+//
+//  class Gto::Pattern
+//
+//  A compiled name pattern for the Reader's find*() functions. Make
+//  one and use it for as many queries (and readers) as you like;
+//  matching is thread safe.
+//
+//  Regex patterns are POSIX extended regular expressions which match
+//  anywhere in the name (anchor them with ^ and $ if needed). Glob
+//  patterns use * ? and [...] ([!...] negates) and must match the
+//  whole name.
+//
+
+class GTO_API Pattern
+{
+public:
+    enum Syntax
+    {
+        Regex,
+        Glob
+    };
+
+    Pattern();
+    explicit Pattern(const std::string& pattern, Syntax syntax = Regex);
+    ~Pattern();
+
+    //
+    //  Returns false if the pattern doesn't compile; it then matches
+    //  nothing.
+    //
+
+    bool            compile(const std::string& pattern, Syntax syntax = Regex);
+    bool            isValid() const { return m_kind != Invalid; }
+
+    const std::string& pattern() const { return m_pattern; }
+
+    bool            matches(const std::string&) const;
+
+private:
+    Pattern(const Pattern&);
+    Pattern& operator=(const Pattern&);
+
+    void            clear();
+
+    enum Kind
+    {
+        Invalid,
+        Exact,          // glob without wildcards
+        Substring,      // regex without special characters
+        Compiled
+    };
+
+    std::string     m_pattern;
+    Kind            m_kind;
+    void*           m_regex;
+};
+
+} // Gto
+
+#endif // __Gto__Pattern__h__
@@ -0,0 +1,162 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#include "PositionalFile.h"
+#include <string.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace Gto {
+
+PositionalFile::PositionalFile()
+#ifdef _WIN32
+    : m_handle(INVALID_HANDLE_VALUE),
+#else
+    : m_fd(-1),
+#endif
+      m_size(0)
+{
+}
+
+PositionalFile::~PositionalFile()
+{
+    close();
+}
+
+bool
+PositionalFile::open(const char* filename)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE h = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fsize;
+    if (!GetFileSizeEx(h, &fsize))
+    {
+        CloseHandle(h);
+        return false;
+    }
+
+    m_handle = h;
+    m_size   = uint64(fsize.QuadPart);
+#else
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat buf;
+    if (fstat(fd, &buf))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    m_fd   = fd;
+    m_size = uint64(buf.st_size);
+#endif
+
+    return true;
+}
+
+void
+PositionalFile::close()
+{
+#ifdef _WIN32
+    if (m_handle != INVALID_HANDLE_VALUE) CloseHandle((HANDLE)m_handle);
+    m_handle = INVALID_HANDLE_VALUE;
+#else
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+#endif
+    m_size = 0;
+}
+
+bool
+PositionalFile::isOpen() const
+{
+#ifdef _WIN32
+    return m_handle != INVALID_HANDLE_VALUE;
+#else
+    return m_fd >= 0;
+#endif
+}
+
+bool
+PositionalFile::read(uint64 offset, void* buffer, size_t bytes) const
+{
+    char* p = (char*)buffer;
+
+    while (bytes)
+    {
+#ifdef _WIN32
+        DWORD chunk = bytes > (1u << 30) ? DWORD(1u << 30) : DWORD(bytes);
+        DWORD got   = 0;
+        OVERLAPPED o;
+        memset(&o, 0, sizeof(o));
+        o.Offset     = DWORD(offset & 0xffffffff);
+        o.OffsetHigh = DWORD(offset >> 32);
+
+        if (!ReadFile((HANDLE)m_handle, p, chunk, &got, &o) || got == 0)
+        {
+            return false;
+        }
+#else
+        size_t chunk = bytes > (1u << 30) ? size_t(1u << 30) : bytes;
+        ssize_t got  = pread(m_fd, p, chunk, off_t(offset));
+
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+#endif
+        p      += got;
+        offset += got;
+        bytes  -= got;
+    }
+
+    return true;
+}
+
+} // Gto
@@ -0,0 +1,90 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#ifndef __Gto__PositionalFile__h__
+#define __Gto__PositionalFile__h__
+
+#include <Gto/Header.h>
+#include <sys/types.h>
+
+namespace Gto {
+
+//
+//  class PositionalFile
+//
+//  Read-only file handle without a shared cursor. Every read names
+//  its own offset (pread() or an OVERLAPPED ReadFile()) so a single
+//  handle can be used from any number of threads at once.
+//
+//  Internal to the library; Reader uses it for its parallel and
+//  thread safe access paths.
+//
+
+class PositionalFile
+{
+public:
+    PositionalFile();
+    ~PositionalFile();
+
+    bool        open(const char* filename);
+    void        close();
+    bool        isOpen() const;
+
+    uint64      size() const { return m_size; }
+
+    //
+    //  Reads exactly bytes at offset. Returns false on a short read
+    //  or error.
+    //
+
+    bool        read(uint64 offset, void* buffer, size_t bytes) const;
+
+private:
+    PositionalFile(const PositionalFile&);
+    PositionalFile& operator=(const PositionalFile&);
+
+private:
+#ifdef _WIN32
+    void*       m_handle;
+#else
+    int         m_fd;
+#endif
+    uint64      m_size;
+};
+
+} // Gto
+
+#endif // __Gto__PositionalFile__h__
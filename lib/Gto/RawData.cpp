@@ -124,26 +124,40 @@ RawDataBase::~RawDataBase()
     {
         delete objects[i];
     }
+
+    for (size_t i=0; i < arenas.size(); i++)
+    {
+        delete arenas[i];
+    }
 }
 
 //----------------------------------------------------------------------
 
-RawDataBaseReader::RawDataBaseReader(unsigned int mode) : Reader(mode)
+RawDataBaseReader::RawDataBaseReader(unsigned int mode, bool useArena) 
+    : Reader(mode), m_useArena(useArena)
 {
     m_dataBase = new RawDataBase;
 }
 
 RawDataBaseReader::~RawDataBaseReader()
 {
+    keepArena();
     delete m_dataBase;
 }
 
+void
+RawDataBaseReader::keepArena()
+{
+    if (Arena* a = releaseArena()) m_dataBase->arenas.push_back(a);
+}
+
 bool
 RawDataBaseReader::open(const char *filename)
 {
     if (Reader::open(filename))
     {
         m_dataBase->strings = stringTable();
+        keepArena();
         return true;
     }
     else
@@ -158,6 +172,7 @@ RawDataBaseReader::open(std::istream& in, const char *name, unsigned int ormode)
     if (Reader::open(in, name, ormode))
     {
         m_dataBase->strings = stringTable();
+        keepArena();
         return true;
     }
     else
@@ -210,6 +225,10 @@ RawDataBaseReader::data(const PropertyInfo& info, size_t bytes)
     {
         p->voidData = NULL;
     }
+    else if (m_useArena && p->type != Gto::String)
+    {
+        p->voidData = allocateData(bytes);
+    }
     else
     {
         p->voidData = new char[bytes];
@@ -139,6 +139,7 @@ struct GTO_API RawDataBase
 
     Objects         objects;
     Strings         strings;
+    std::vector<Arena*> arenas;     // property data, when read into one
 };
 
 //----------------------------------------------------------------------
@@ -155,11 +156,18 @@ struct GTO_API RawDataBase
 //  You need to delete the RawDataBase that's returned from the dataBase()
 //  function. The RawDataBaseReader will not delete it.
 //
+//  With useArena the non-string property data is allocated from the
+//  Reader's arena (see Reader::allocateData()) instead of one new[]
+//  per property; the arenas are kept in RawDataBase::arenas and those
+//  properties are not marked _allocated. Code that frees voidData
+//  itself must not use it.
+//
 
 class GTO_API RawDataBaseReader : public Reader
 {
 public:
-    explicit RawDataBaseReader(unsigned int mode = None);
+    explicit RawDataBaseReader(unsigned int mode = None, 
+                               bool useArena = false);
     virtual ~RawDataBaseReader();
 
     virtual bool        open(const char *filename);
@@ -185,8 +193,12 @@ protected:
     virtual void*       data(const PropertyInfo&, size_t bytes);
     virtual void        dataRead(const PropertyInfo&);
 
+protected:
+    void                keepArena();
+
 protected:
     RawDataBase*        m_dataBase;
+    bool                m_useArena;
 };
 
 
@@ -34,13 +34,20 @@
 //  DAMAGE.
 //
 
-#include "zhacks.h"
 #include "Reader.h"
 #include "Utilities.h"
+#include "PositionalFile.h"
+#include "Parallel.h"
+#include "BlockFile.h"
+#include "Filters.h"
+#include "TextParser.h"
 #include <fstream>
 #include <sstream>
 #include <iterator>
+#include <list>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 #include <sys/stat.h>
 #include <assert.h>
 #ifdef GTO_SUPPORT_ZIP
@@ -48,9 +55,16 @@
 #endif
 #include <string.h>
 #include <stdlib.h>
-#include <regex.h>
-
-int GTOParse(Gto::Reader*);
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #if ( __GNUC__ == 2 )
     #define IOS_CUR ios::cur
@@ -63,19 +77,146 @@ int GTOParse(Gto::Reader*);
 namespace Gto {
 using namespace std;
 
+//
+//  Map the whole file read-only. Returns 0 if the file could not be
+//  mapped (empty files included).
+//
+
+static void*
+mapFile(const char* filename, size_t& size)
+{
+    size = 0;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+
+    LARGE_INTEGER fsize;
+    if (!GetFileSizeEx(file, &fsize) || fsize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return 0;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return 0;
+
+    void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);   // the view keeps the mapping alive
+    if (!p) return 0;
+
+    size = size_t(fsize.QuadPart);
+    return p;
+#else
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat buf;
+    if (fstat(fd, &buf) || buf.st_size == 0)
+    {
+        ::close(fd);
+        return 0;
+    }
+
+    void* p = mmap(0, size_t(buf.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);            // the mapping keeps the file alive
+    if (p == MAP_FAILED) return 0;
+
+    size = size_t(buf.st_size);
+    return p;
+#endif
+}
+
+static void
+unmapFile(void* p, size_t size)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(p);
+#else
+    munmap(p, size);
+#endif
+}
+
+//
+//  Swap num values of the given type in place
+//
+
+static void
+swapBuffer(void* buffer, uint32 type, size_t num)
+{
+    switch (type)
+    {
+      case Gto::Int: 
+      case Gto::String:
+      case Gto::Float: 
+          swapWords(buffer, num);
+          break;
+                  
+      case Gto::Short:
+      case Gto::Half: 
+          swapShorts(buffer, num);
+          break;
+                  
+      case Gto::Double: 
+          swapDoubleWords(buffer, num);
+          break;
+                  
+      case Gto::Byte:
+      case Gto::Boolean: 
+          break;
+    }
+}
+
+static const size_t SwapChunkSize = 64 * 1024;     // multiple of 8
+
+//
+//  Turn num values of a property as stored in the file into native
+//  values: undo the shuffle (done in the writer's byte order), swap,
+//  then undo the delta.
+//
+
+static void
+decodeBuffer(void* buffer, const Reader::PropertyInfo& prop, 
+             size_t num, bool swapped)
+{
+    size_t ds = dataSize(prop.type);
+
+    if ((prop.pad & ShuffleFilter) && ds > 1 && num)
+    {
+        std::vector<char> tmp((char*)buffer, (char*)buffer + num * ds);
+        unshuffleBytes(&tmp.front(), buffer, num, ds);
+    }
+
+    if (swapped) swapBuffer(buffer, prop.type, num);
+
+    if (prop.pad & DeltaFilter) deltaDecode(buffer, num, prop.width, ds);
+}
+
 Reader::Reader(unsigned int mode) 
-    : m_in(0), 
+    : m_stringMapValid(true),
+      m_in(0), 
       m_inRAM(0), 
       m_inRAMSize(0), 
       m_inRAMCurrentPos(0),
+      m_mapping(0),
+      m_mappingSize(0),
+      m_positional(0),
+      m_blocks(0),
       m_gzfile(0), 
       m_gzrval(0), 
+      m_inTime(0),
+      m_inSize(0),
       m_needsClosing(false),
       m_error(false), 
       m_mode(mode),
       m_linenum(0),
       m_charnum(0),
-      m_currentReadOffset(0)
+      m_currentReadOffset(0),
+      m_indexedCount(size_t(-1)),
+      m_arena(0),
+      m_requestedBytes(0)
 {
 }
 
@@ -83,6 +224,29 @@ Reader::~Reader()
 {
     close();
     clearInfo();
+    delete m_arena;
+}
+
+void*
+Reader::allocateData(size_t bytes)
+{
+    if (!m_arena) m_arena = new Arena;
+
+    if (m_requestedBytes)
+    {
+        m_arena->reserve(m_requestedBytes);
+        m_requestedBytes = 0;
+    }
+
+    return m_arena->allocate(bytes);
+}
+
+Arena*
+Reader::releaseArena()
+{
+    Arena* a = m_arena;
+    m_arena = 0;
+    return a;
 }
 
 void
@@ -93,6 +257,14 @@ Reader::clearInfo()
     m_properties.clear();
     m_strings.clear();
     m_stringMap.clear();
+    m_stringDecoded.clear();
+    m_stringMapValid = true;
+    m_stringBlock.clear();
+    m_stringOffsets.clear();
+    m_objectIndex.clear();
+    m_componentIndex.clear();
+    m_propertyIndex.clear();
+    m_indexedCount = size_t(-1);
 }
 
 bool
@@ -101,7 +273,7 @@ Reader::open(void const *pData, size_t dataSize, const char *name)
     //if (m_in) return false;
     if (pData == NULL) return false;
     if (dataSize <= 0) return false;
-    if (m_in || m_gzfile) close();
+    if (m_in || m_gzfile || m_blocks || m_mapping) close();
 
     clearInfo();
 
@@ -120,7 +292,7 @@ Reader::open(void const *pData, size_t dataSize, const char *name)
     {
         readMagicNumber();
 
-        if (m_header.magic != Header::Magic ||
+        if (m_header.magic != Header::Magic &&
             m_header.magic != Header::Cigam)
         {
             return false;
@@ -133,7 +305,7 @@ Reader::open(void const *pData, size_t dataSize, const char *name)
 bool
 Reader::open(istream& i, const char *name, unsigned int ormode)
 {
-    if ((m_in && m_in != &i) || m_gzfile) close();
+    if ((m_in && m_in != &i) || m_gzfile || m_blocks || m_mapping) close();
 
     clearInfo();
 
@@ -150,7 +322,7 @@ Reader::open(istream& i, const char *name, unsigned int ormode)
     {
         readMagicNumber();
 
-        if (m_header.magic != Header::Magic ||
+        if (m_header.magic != Header::Magic &&
             m_header.magic != Header::Cigam)
         {
             return false;
@@ -164,7 +336,7 @@ bool
 Reader::open(const char *filename)
 {
     //if (m_in) return false;
-    if (m_in || m_gzfile) close();
+    if (m_in || m_gzfile || m_blocks || m_mapping) close();
     
     clearInfo();
     
@@ -176,6 +348,19 @@ Reader::open(const char *filename)
     }
 
     m_inName = filename;
+    m_inSize = uint64(buf.st_size);
+#if defined(__linux__)
+    m_inTime = uint64(buf.st_mtim.tv_sec) * 1000000000 + buf.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    m_inTime = uint64(buf.st_mtimespec.tv_sec) * 1000000000 + buf.st_mtimespec.tv_nsec;
+#else
+    m_inTime = uint64(buf.st_mtime);
+#endif
+
+    if ((m_mode & MemoryMapped) && !(m_mode & TextOnly) && openMapped(filename))
+    {
+        return readBinaryGTO();
+    }
 
     //
     //  Fail if not compiled with zlib and the extension is gz
@@ -195,6 +380,32 @@ Reader::open(const char *filename)
     //
 
 #ifdef GTO_SUPPORT_ZIP
+    //
+    //  Block compressed files are read through their index, anything
+    //  else gzip or raw goes through zlib's stream reader
+    //
+
+    m_blocks = new BlockReader;
+
+    if (m_blocks->open(filename))
+    {
+        m_needsClosing = true;
+        m_error = false;
+        readMagicNumber();
+        return readBinaryGTO();
+    }
+
+    const char* missing = m_blocks->missingCodec();
+    delete m_blocks;
+    m_blocks = 0;
+
+    if (missing)
+    {
+        fail( std::string("this library was not compiled with ") + 
+              missing + " support" );
+        return false;
+    }
+
     m_gzfile = gzopen(filename, "rb");
 
     if (!m_gzfile)
@@ -239,7 +450,14 @@ Reader::open(const char *filename)
             return false;
         }
 
-        return open(*m_in, filename, TextOnly);
+        //
+        //  open(istream&) leaves the stream to the caller; this one
+        //  is ours
+        //
+
+        bool ok = open(*m_in, filename, TextOnly);
+        m_needsClosing = true;
+        return ok;
     }
     else
     {
@@ -247,25 +465,73 @@ Reader::open(const char *filename)
     }
 }
 
+bool
+Reader::openMapped(const char* filename)
+{
+    size_t size = 0;
+    void*  p    = mapFile(filename, size);
+
+    if (!p) return false;
+
+    //
+    //  Only raw binary files can be used in place. Anything else
+    //  (text, gzipped) goes through the regular stream path.
+    //
+
+    uint32 magic = 0;
+    if (size >= sizeof(Header)) memcpy(&magic, p, sizeof(uint32));
+
+    if (magic != Header::Magic && magic != Header::Cigam)
+    {
+        unmapFile(p, size);
+        return false;
+    }
+
+    m_mapping         = p;
+    m_mappingSize     = size;
+    m_inRAM           = (char*)p;
+    m_inRAMSize       = size;
+    m_inRAMCurrentPos = 0;
+    m_needsClosing    = true;
+    m_error           = false;
+
+    readMagicNumber();
+    return true;
+}
+
 void
 Reader::close()
 {
     m_inRAM = 0;
     m_inRAMSize = 0;
+    m_inRAMCurrentPos = 0;
+
+    if (m_mapping)
+    {
+        unmapFile(m_mapping, m_mappingSize);
+        m_mapping = 0;
+        m_mappingSize = 0;
+    }
+
+    delete m_positional;
+    m_positional = 0;
 
     if (m_in) 
     {
-        delete m_in;
+        if (m_needsClosing) delete m_in;
         m_in = 0;
+    }
+
 #ifdef GTO_SUPPORT_ZIP
+    if (m_gzfile) 
+    {
+        gzclose( (gzFile)m_gzfile );
+        m_gzfile = 0;
+    }
 
-        if (m_gzfile) 
-        {
-            gzclose( (gzFile)m_gzfile );
-            m_gzfile = 0;
-        }
+    delete m_blocks;
+    m_blocks = 0;
 #endif
-    }
 
     //
     //  Clean everything up in case the Reader
@@ -277,11 +543,14 @@ Reader::close()
 
     m_error        = false;
     m_inName       = "";
+    m_inTime       = 0;
+    m_inSize       = 0;
     m_needsClosing = false;
     m_swapped      = false;
     m_why          = "";
     m_linenum      = 0;
     m_charnum      = 0;
+    m_currentReadOffset = 0;
     memset(&m_header, 0, sizeof(m_header));
 }
 
@@ -324,6 +593,12 @@ Reader::dataRead(const PropertyInfo&)
 {
 }
 
+bool
+Reader::dataMapped(const PropertyInfo&, const void*, size_t)
+{
+    return false;
+}
+
 void
 Reader::descriptionComplete()
 {
@@ -376,21 +651,108 @@ Reader::readHeader()
         return;
     }
 
-    if (m_header.version != GTO_VERSION && m_header.version != 2)
+    if (m_header.version != GTO_VERSION && 
+        m_header.version != GTO_VERSION_FILTERED && 
+        m_header.version != GTO_VERSION_STREAMED && 
+        m_header.version != 2)
     {
         fail( "version mismatch" );
         cerr << "ERROR: Gto::Reader: gto file version == " 
              << m_header.version << ", which is not readable by this version (v"
-             << GTO_VERSION << ")\n";
+             << GTO_VERSION_STREAMED << ")\n";
         return;
     }
 
-    header(m_header);
+    //
+    //  A streamed file's leading header is only a marker; the callback
+    //  gets the one in front of the description
+    //
+
+    if (m_header.version != GTO_VERSION_STREAMED) header(m_header);
+}
+
+bool
+Reader::seekToStreamDescription()
+{
+    //
+    //  The footer is at the very end so the input must be seekable
+    //
+
+    uint64 dataStart = tell();
+    uint64 size = 0;
+
+    if (m_inRAM)
+    {
+        size = m_inRAMSize;
+    }
+    else if (m_in)
+    {
+        m_in->seekg(0, ios::end);
+        streamoff end = m_in->tellg();
+
+        if (end < 0)
+        {
+            fail("streamed file needs a seekable input stream");
+            return false;
+        }
+
+        size = uint64(end);
+    }
+#ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        size = m_blocks->size();
+    }
+    else if (m_gzfile && gzdirect((gzFile)m_gzfile) && m_inSize)
+    {
+        //
+        //  zlib reading an uncompressed file as is
+        //
+
+        size = m_inSize;
+    }
+#endif
+    else
+    {
+        fail("streamed file needs a seekable input (uncompressed or indexed)");
+        return false;
+    }
+
+    if (size < dataStart + sizeof(StreamFooter))
+    {
+        fail("streamed file is truncated");
+        return false;
+    }
+
+    StreamFooter footer;
+    seekTo(size - sizeof(StreamFooter));
+    read((char*)&footer, sizeof(StreamFooter));
+    if (m_error) return false;
+
+    if (m_swapped)
+    {
+        swapDoubleWords(&footer.descriptionOffset, 1);
+        swapWords(&footer.magic, 1);
+    }
+
+    if (footer.magic != Header::Magic ||
+        footer.descriptionOffset < dataStart ||
+        footer.descriptionOffset >= size)
+    {
+        fail("streamed file has a bad footer");
+        return false;
+    }
+
+    seekTo(footer.descriptionOffset);
+    readMagicNumber();
+    readHeader();
+    return !m_error;
 }
 
 int
 Reader::internString(const std::string& s)
 {
+    buildStringMap();
     StringMap::iterator i = m_stringMap.find(s);
 
     if (i == m_stringMap.end())
@@ -409,6 +771,12 @@ Reader::internString(const std::string& s)
 void
 Reader::readStringTable()
 {
+    if (m_mode & LazyStrings)
+    {
+        readStringBlock();
+        return;
+    }
+
     for (uint32 i=0; i < m_header.numStrings; i++)
     {
         string s;
@@ -424,6 +792,97 @@ Reader::readStringTable()
     }
 }
 
+//
+//  LazyStrings: keep the table as it is in the file plus where each
+//  string starts. m_strings gets one empty slot per string which is
+//  filled in when first used.
+//
+
+void
+Reader::readStringBlock()
+{
+    uint32 n = m_header.numStrings;
+    m_stringOffsets.resize(n);
+
+    if (m_inRAM)
+    {
+        const char* start = m_inRAM + m_inRAMCurrentPos;
+        const char* end   = m_inRAM + m_inRAMSize;
+        const char* p     = start;
+
+        for (uint32 i=0; i < n; i++)
+        {
+            const char* z = (const char*)memchr(p, 0, end - p);
+
+            if (!z)
+            {
+                fail("malformed file, unterminated string table");
+                return;
+            }
+
+            m_stringOffsets[i] = p - start;
+            p = z + 1;
+        }
+
+        m_stringBlock.assign(start, p);
+        m_inRAMCurrentPos += p - start;
+    }
+    else
+    {
+        m_stringBlock.clear();
+
+        for (uint32 i=0; i < n; i++)
+        {
+            m_stringOffsets[i] = m_stringBlock.size();
+            char c;
+
+            for (get(c); c && notEOF(); get(c))
+            {
+                m_stringBlock.push_back(c);
+            }
+
+            m_stringBlock.push_back(0);
+        }
+    }
+
+    m_strings.assign(n, std::string());
+    m_stringDecoded.assign(n, false);
+    m_stringMap.clear();
+    m_stringMapValid = false;
+}
+
+void
+Reader::decodeString(unsigned int i) const
+{
+    if (i < m_stringDecoded.size() && !m_stringDecoded[i])
+    {
+        m_strings[i] = (const char*)&m_stringBlock[m_stringOffsets[i]];
+        m_stringDecoded[i] = true;
+    }
+}
+
+void
+Reader::buildStringMap() const
+{
+    if (m_stringMapValid) return;
+
+    m_stringMap.reserve(m_stringOffsets.size());
+
+    for (size_t i=0; i < m_stringOffsets.size(); i++)
+    {
+        m_stringMap[(const char*)&m_stringBlock[m_stringOffsets[i]]] = int(i);
+    }
+
+    m_stringMapValid = true;
+}
+
+const Reader::StringTable&
+Reader::stringTable()
+{
+    for (size_t i=0; i < m_stringDecoded.size(); i++) decodeString(i);
+    return m_strings;
+}
+
 void
 Reader::readObjects()
 {
@@ -571,6 +1030,12 @@ Reader::readProperties()
             {
                 swapWords(&p, sizeof(PropertyHeader) / sizeof(int));
             }
+
+            //
+            //  pad only holds filters from version 4 on
+            //
+
+            if (m_header.version < GTO_VERSION_FILTERED) p.pad = 0;
             
             p.component = &c;
 
@@ -596,54 +1061,98 @@ Reader::readProperties()
     }
 }
 
-int
-Reader::findObject(const std::string &name) const
+//
+//  The query API maps (range offset, name id) pairs to indices. The
+//  index is rebuilt if the info vectors have grown since (the text
+//  parser adds to them as it goes). The first of several objects,
+//  components or properties with the same name wins, as before.
+//
+
+static inline uint64
+nameKey(int offset, int name)
 {
-    std::map<std::string, int>::const_iterator it = m_stringMap.find(name);
-    if (it == m_stringMap.end())
+    return (uint64(uint32(offset)) << 32) | uint32(name);
+}
+
+void
+Reader::indexNames() const
+{
+    size_t count = m_objects.size() + m_components.size() + m_properties.size();
+    if (count == m_indexedCount) return;
+
+    m_objectIndex.clear();
+    m_componentIndex.clear();
+    m_propertyIndex.clear();
+
+    for (size_t i=0; i < m_objects.size(); i++)
     {
-        return -1;
+        const ObjectInfo& o = m_objects[i];
+        m_objectIndex.insert(std::make_pair(uint64(o.name), int(i)));
+
+        for (uint32 j=0; j < o.numComponents; j++)
+        {
+            int ci = o.componentOffset() + j;
+            m_componentIndex.insert(
+                std::make_pair(nameKey(o.componentOffset(), m_components[ci].name), ci));
+        }
     }
 
-    int j = 0;
-    uint32 oname = uint32(it->second);
-    
-    for (Objects::const_iterator oit=m_objects.begin(); oit!=m_objects.end(); ++oit, ++j)
+    for (size_t i=0; i < m_components.size(); i++)
     {
-        if (oit->name == oname)
+        const ComponentInfo& c = m_components[i];
+
+        for (uint32 j=0; j < c.numProperties; j++)
         {
-            return j;
+            int pi = c.propertyOffset() + j;
+            m_propertyIndex.insert(
+                std::make_pair(nameKey(c.propertyOffset(), m_properties[pi].name), pi));
         }
     }
-    
-    return -1;
+
+    m_indexedCount = count;
 }
 
 int
-Reader::findComponent(const ObjectInfo &o, const std::string &name) const
+Reader::findObject(const std::string &name) const
 {
-    std::map<std::string, int>::const_iterator it = m_stringMap.find(name);
+    buildStringMap();
+    StringMap::const_iterator it = m_stringMap.find(name);
     if (it == m_stringMap.end())
     {
         return -1;
     }
 
-    int j = 0;
-    uint32 cname = uint32(it->second);
+    indexNames();
+    NameIndex::const_iterator i = m_objectIndex.find(uint64(uint32(it->second)));
+    return i == m_objectIndex.end() ? -1 : i->second;
+}
 
-    Components::const_iterator cit = m_components.begin() + o.componentOffset();
-    Components::const_iterator eit = cit + o.numComponents;
-    while (cit != eit)
+int
+Reader::findComponent(const ObjectInfo &o, const std::string &name) const
+{
+    buildStringMap();
+    StringMap::const_iterator it = m_stringMap.find(name);
+    if (it == m_stringMap.end() || o.numComponents == 0)
     {
-        if (cit->name == cname)
-        {
-            return int(o.componentOffset() + j);
-        }
-        ++cit;
-        ++j;
+        return -1;
     }
 
-    return -1;
+    //
+    //  An object with no components shares its offset with the next
+    //  one, so the range check matters
+    //
+
+    indexNames();
+    NameIndex::const_iterator i = 
+        m_componentIndex.find(nameKey(o.componentOffset(), it->second));
+
+    if (i == m_componentIndex.end() ||
+        i->second >= int(o.componentOffset() + o.numComponents))
+    {
+        return -1;
+    }
+
+    return i->second;
 }
 
 int
@@ -660,28 +1169,24 @@ Reader::findComponent(const std::string &oname, const std::string &cname) const
 int
 Reader::findProperty(const ComponentInfo &c, const std::string &name) const
 {
-    std::map<std::string, int>::const_iterator it = m_stringMap.find(name);
-    if (it == m_stringMap.end())
+    buildStringMap();
+    StringMap::const_iterator it = m_stringMap.find(name);
+    if (it == m_stringMap.end() || c.numProperties == 0)
     {
         return -1;
     }
 
-    int j = 0;
-    uint32 pname = uint32(it->second);
+    indexNames();
+    NameIndex::const_iterator i = 
+        m_propertyIndex.find(nameKey(c.propertyOffset(), it->second));
 
-    Properties::const_iterator pit = m_properties.begin() + c.propertyOffset();
-    Properties::const_iterator eit = pit + c.numProperties;
-    while (pit != eit)
+    if (i == m_propertyIndex.end() ||
+        i->second >= int(c.propertyOffset() + c.numProperties))
     {
-        if (pit->name == pname)
-        {
-            return int(c.propertyOffset() + j);
-        }
-        ++pit;
-        ++j;
+        return -1;
     }
 
-    return -1;
+    return i->second;
 }
 
 int
@@ -707,51 +1212,82 @@ Reader::findProperty(const std::string &oname, const std::string &cname, const s
 }
 
 size_t
-Reader::findObjects(const std::string &pattern, std::vector<std::string> &names) const
+Reader::findObjects(const Pattern &pattern, Indices &indices) const
 {
-    names.clear();
-    
-    regex_t e;
+    indices.clear();
 
-    if (regcomp(&e, pattern.c_str(), REG_EXTENDED|REG_NOSUB) == 0)
+    for (size_t i=0; i < m_objects.size(); i++)
     {
-        Objects::const_iterator oit = m_objects.begin();
-        while (oit != m_objects.end())
+        if (pattern.matches(stringFromId(m_objects[i].name)))
         {
-            std::string oname = stringFromId(oit->name);
-            if (regexec(&e, oname.c_str(), 0, 0, 0) == 0)
-            {
-                names.push_back(oname);
-            }
-            ++oit;
+            indices.push_back(int(i));
         }
-        regfree(&e);
     }
 
-    return names.size();
+    return indices.size();
 }
 
 size_t
-Reader::findComponents(const ObjectInfo &o, const std::string &pattern, std::vector<std::string> &names) const
+Reader::findComponents(const ObjectInfo &o, const Pattern &pattern, Indices &indices) const
 {
-    names.clear();
+    indices.clear();
+
+    for (uint32 i=0; i < o.numComponents; i++)
+    {
+        int ci = o.coffset + i;
+
+        if (pattern.matches(stringFromId(m_components[ci].name)))
+        {
+            indices.push_back(ci);
+        }
+    }
+
+    return indices.size();
+}
 
-    regex_t e;
+size_t
+Reader::findProperties(const ComponentInfo &c, const Pattern &pattern, Indices &indices) const
+{
+    indices.clear();
 
-    if (regcomp(&e, pattern.c_str(), REG_EXTENDED|REG_NOSUB) == 0)
+    for (uint32 i=0; i < c.numProperties; i++)
     {
-        Components::const_iterator cit = m_components.begin() + o.coffset;
-        Components::const_iterator eit = cit + o.numComponents;
-        while (cit != eit) // m_components.end())
+        int pi = c.poffset + i;
+
+        if (pattern.matches(stringFromId(m_properties[pi].name)))
         {
-            std::string cname = stringFromId(cit->name);
-            if (regexec(&e, cname.c_str(), 0, 0, 0) == 0)
-            {
-                names.push_back(cname);
-            }
-            ++cit;
+            indices.push_back(pi);
         }
-        regfree(&e);
+    }
+
+    return indices.size();
+}
+
+size_t
+Reader::findObjects(const std::string &pattern, std::vector<std::string> &names) const
+{
+    Indices indices;
+    findObjects(Pattern(pattern), indices);
+
+    names.clear();
+    for (size_t i=0; i < indices.size(); i++)
+    {
+        names.push_back(stringFromId(m_objects[indices[i]].name));
+    }
+
+    return names.size();
+}
+
+size_t
+Reader::findComponents(const ObjectInfo &o, const std::string &pattern, std::vector<std::string> &names) const
+{
+    Indices indices;
+    findComponents(o, Pattern(pattern), indices);
+
+    names.clear();
+    for (size_t i=0; i < indices.size(); i++)
+    {
+        names.push_back(stringFromId(m_components[indices[i]].name));
     }
 
     return names.size();
@@ -775,24 +1311,13 @@ Reader::findComponents(const std::string &o, const std::string &pattern, std::ve
 size_t
 Reader::findProperties(const ComponentInfo &c, const std::string &pattern, std::vector<std::string> &names) const
 {
-    names.clear();
+    Indices indices;
+    findProperties(c, Pattern(pattern), indices);
 
-    regex_t e;
-
-    if (regcomp(&e, pattern.c_str(), REG_EXTENDED|REG_NOSUB) == 0)
+    names.clear();
+    for (size_t i=0; i < indices.size(); i++)
     {
-        Properties::const_iterator pit = m_properties.begin() + c.poffset;
-        Properties::const_iterator eit = pit + c.numProperties;
-        while (pit != eit) // m_properties.end())
-        {
-            std::string pname = stringFromId(pit->name);
-            if (regexec(&e, pname.c_str(), 0, 0, 0) == 0)
-            {
-                names.push_back(pname);
-            }
-            ++pit;
-        }
-        regfree(&e);
+        names.push_back(stringFromId(m_properties[indices[i]].name));
     }
 
     return names.size();
@@ -849,6 +1374,16 @@ Reader::accessProperty(PropertyInfo &p, bool queryUp)
 {
     if (queryProperty(p, queryUp))
     {
+        ComponentInfo& c = *((ComponentInfo*) p.component);
+
+        if (c.flags & Gto::Transposed)
+        {
+            std::vector<PropertyInfo*> wanted(1, &p);
+            seekTo(m_properties[c.poffset]);
+            readTransposed(c, wanted);
+            return true;
+        }
+
         seekTo(p);
         readProperty(p);
         return true;
@@ -875,101 +1410,975 @@ Reader::queryComponent(ComponentInfo &c, bool queryUp)
         c.componentData = r.m_data;
         return c.requested;
     }
-    else
+    else
+    {
+        return false;
+    }
+}
+
+bool
+Reader::accessComponent(ComponentInfo& c, bool queryUp)
+{
+    if (queryComponent(c, queryUp))
+    {
+        if ((c.flags & Gto::Transposed) && c.numProperties)
+        {
+            std::vector<PropertyInfo*> wanted;
+
+            for (uint32 j=0; j < c.numProperties; j++)
+            {
+                PropertyInfo& p = m_properties[c.poffset + j];
+                if (queryProperty(p, false)) wanted.push_back(&p);
+            }
+
+            seekTo(m_properties[c.poffset]);
+            readTransposed(c, wanted);
+            return !m_error;
+        }
+
+        for (uint32 j=0; j < c.numProperties; j++)
+        {
+            PropertyInfo& p = m_properties[c.poffset + j];
+            if (!accessProperty(p, false))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+bool
+Reader::accessComponent(ComponentInfo& c)
+{
+    return accessComponent(c, true);
+}
+
+bool
+Reader::queryObject(ObjectInfo &o)
+{
+    Request r = object(stringFromId(o.name), 
+                       stringFromId(o.protocolName), 
+                       o.protocolVersion,
+                       o);
+
+    o.requested = r.m_want;
+    o.objectData = r.m_data;
+
+    return o.requested;
+}
+
+bool
+Reader::accessObject(ObjectInfo& o)
+{
+    if (queryObject(o))
+    {
+        for (uint32 q=0; q < o.numComponents; q++)
+        {
+            assert( (o.coffset+q) < m_components.size() );
+
+            ComponentInfo& c = m_components[o.coffset + q];
+            if (!accessComponent(c, false))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+namespace {
+
+//
+//  One requested property in a batch read and the pieces it is split
+//  into so that a few huge properties still spread over all threads.
+//
+
+struct BatchJob
+{
+    Reader::PropertyInfo*   prop;
+    char*                   buffer;
+    size_t                  bytes;
+    bool                    ok;
+};
+
+struct BatchPiece
+{
+    size_t                  job;
+    size_t                  begin;
+    size_t                  end;
+};
+
+static const size_t BatchPieceSize = 4 * 1024 * 1024;  // multiple of 8
+
+struct BatchRead
+{
+    std::vector<BatchJob>*      jobs;
+    std::vector<BatchPiece>*    pieces;
+    const char*                 inRAM;
+    size_t                      inRAMSize;
+    const PositionalFile*       file;
+    const BlockReader*          blocks;
+    bool                        swapped;
+
+    void operator()(size_t i)
+    {
+        const BatchPiece& piece = (*pieces)[i];
+        BatchJob& job           = (*jobs)[piece.job];
+        uint64 offset           = job.prop->offset + piece.begin;
+        size_t bytes            = piece.end - piece.begin;
+        char* buffer            = job.buffer + piece.begin;
+
+        if (inRAM)
+        {
+            if (offset + bytes > inRAMSize)
+            {
+                job.ok = false;
+                return;
+            }
+
+            if (swapped && !job.prop->pad)
+            {
+                size_t ds = dataSize(job.prop->type);
+
+                for (size_t i=0; i < bytes; i += SwapChunkSize)
+                {
+                    size_t n = std::min(SwapChunkSize, bytes - i);
+                    memcpy(buffer + i, inRAM + offset + i, n);
+                    swapBuffer(buffer + i, job.prop->type, n / ds);
+                }
+
+                return;
+            }
+
+            memcpy(buffer, inRAM + offset, bytes);
+        }
+#ifdef GTO_SUPPORT_ZIP
+        else if (blocks)
+        {
+            if (!blocks->readAt(offset, buffer, bytes))
+            {
+                job.ok = false;
+                return;
+            }
+        }
+#endif
+        else if (!file->read(offset, buffer, bytes))
+        {
+            job.ok = false;
+            return;
+        }
+
+        //
+        //  Filtered properties are decoded whole afterwards
+        //
+
+        if (swapped && !job.prop->pad)
+        {
+            swapBuffer(buffer, job.prop->type, bytes / dataSize(job.prop->type));
+        }
+    }
+};
+
+struct BatchDecode
+{
+    std::vector<BatchJob*>*     jobs;
+    bool                        swapped;
+
+    void operator()(size_t i)
+    {
+        BatchJob& job = *(*jobs)[i];
+        decodeBuffer(job.buffer, *job.prop, 
+                     job.bytes / dataSize(job.prop->type), swapped);
+    }
+};
+
+//
+//  Strided reads whose records are further apart than this read each
+//  record on its own rather than reading through the gaps
+//
+
+static const size_t MaxRecordGap = 4096;
+
+struct OffsetLess
+{
+    bool operator()(const BatchJob& a, const BatchJob& b) const
+    {
+        return a.prop->offset < b.prop->offset;
+    }
+};
+
+} // namespace
+
+bool
+Reader::openPositional()
+{
+    if (m_positional) return m_positional->isOpen();
+
+    m_positional = new PositionalFile;
+
+    //
+    //  Only uncompressed binary files we opened ourselves can be read
+    //  behind the stream's back
+    //
+
+    if (!m_needsClosing || m_inRAM || m_inName.empty() ||
+        !m_positional->open(m_inName.c_str()))
+    {
+        return false;
+    }
+
+    uint32 magic = 0;
+
+    if (!m_positional->read(0, &magic, sizeof(magic)) ||
+        (magic != Header::Magic && magic != Header::Cigam))
+    {
+        m_positional->close();
+        return false;
+    }
+
+    return true;
+}
+
+size_t
+Reader::accessProperties(std::vector<PropertyInfo*>& props, 
+                         unsigned int threadCount)
+{
+    //
+    //  Make the requests serially, each object and component is asked
+    //  about at most once. 0 = not asked yet, 1 = wanted, 2 = not wanted.
+    //
+
+    std::vector<char> objectState(m_objects.size(), 0);
+    std::vector<char> componentState(m_components.size(), 0);
+    std::vector<BatchJob> jobs;
+    std::vector<PropertyInfo*> transposed;
+    size_t count = 0;
+
+    for (size_t i=0; i < props.size(); i++)
+    {
+        PropertyInfo& p  = *props[i];
+        ComponentInfo& c = *((ComponentInfo*) p.component);
+        ObjectInfo& o    = *((ObjectInfo*) c.object);
+        size_t ci        = &c - &m_components.front();
+        size_t oi        = &o - &m_objects.front();
+
+        if (!componentState[ci])
+        {
+            if (!objectState[oi]) objectState[oi] = queryObject(o) ? 1 : 2;
+
+            componentState[ci] = 
+                objectState[oi] == 1 && queryComponent(c, false) ? 1 : 2;
+        }
+
+        if (componentState[ci] != 1 || !queryProperty(p, false)) continue;
+
+        if (c.flags & Gto::Transposed)
+        {
+            transposed.push_back(&p);
+            continue;
+        }
+
+        size_t bytes = size_t(p.size) * p.width * dataSize(p.type);
+
+        if (m_inRAM && !m_swapped && !p.pad && bytes &&
+            p.offset + bytes <= m_inRAMSize &&
+            dataMapped(p, m_inRAM + p.offset, bytes))
+        {
+            dataRead(p);
+            count++;
+            continue;
+        }
+
+        if (char* buffer = (char*) data(p, bytes))
+        {
+            BatchJob job;
+            job.prop   = &p;
+            job.buffer = buffer;
+            job.bytes  = bytes;
+            job.ok     = true;
+            jobs.push_back(job);
+        }
+    }
+
+    //
+    //  Interleaved components are read on this thread, one pass for
+    //  each run of properties from the same component
+    //
+
+    for (size_t i=0; i < transposed.size();)
+    {
+        ComponentInfo& c = *((ComponentInfo*) transposed[i]->component);
+        std::vector<PropertyInfo*> wanted;
+
+        for (; i < transposed.size() && transposed[i]->component == &c; i++)
+        {
+            wanted.push_back(transposed[i]);
+        }
+
+        seekTo(m_properties[c.poffset]);
+        count += readTransposed(c, wanted);
+        if (m_error) return count;
+    }
+
+    if (jobs.empty()) return count;
+
+    if (m_inRAM || m_blocks || openPositional())
+    {
+        std::vector<BatchPiece> pieces;
+
+        for (size_t i=0; i < jobs.size(); i++)
+        {
+            for (size_t b=0; b < jobs[i].bytes; b += BatchPieceSize)
+            {
+                BatchPiece piece;
+                piece.job   = i;
+                piece.begin = b;
+                piece.end   = std::min(jobs[i].bytes, b + BatchPieceSize);
+                pieces.push_back(piece);
+            }
+        }
+
+        BatchRead reader;
+        reader.jobs      = &jobs;
+        reader.pieces    = &pieces;
+        reader.inRAM     = m_inRAM;
+        reader.inRAMSize = m_inRAMSize;
+        reader.file      = m_positional;
+        reader.blocks    = m_blocks;
+        reader.swapped   = m_swapped;
+
+        parallelFor(pieces.size(), threadCount, reader);
+
+        std::vector<BatchJob*> filtered;
+
+        for (size_t i=0; i < jobs.size(); i++)
+        {
+            if (jobs[i].prop->pad && jobs[i].ok) filtered.push_back(&jobs[i]);
+        }
+
+        if (!filtered.empty())
+        {
+            BatchDecode decoder;
+            decoder.jobs    = &filtered;
+            decoder.swapped = m_swapped;
+            parallelFor(filtered.size(), threadCount, decoder);
+        }
+    }
+    else
+    {
+        //
+        //  Single stream: read in file order so compressed files don't
+        //  rewind for every property.
+        //
+
+        std::vector<BatchJob> sorted(jobs);
+        std::sort(sorted.begin(), sorted.end(), OffsetLess());
+
+        for (size_t i=0; i < sorted.size(); i++)
+        {
+            BatchJob& job = sorted[i];
+            seekTo(*job.prop);
+            read(job.buffer, job.bytes);
+
+            if (m_error) return count;
+
+            decodeBuffer(job.buffer, *job.prop, 
+                         job.bytes / dataSize(job.prop->type), m_swapped);
+        }
+    }
+
+    for (size_t i=0; i < jobs.size(); i++)
+    {
+        if (jobs[i].ok)
+        {
+            dataRead(*jobs[i].prop);
+            count++;
+        }
+        else
+        {
+            fail("failed to read property data");
+        }
+    }
+
+    return count;
+}
+
+size_t
+Reader::accessObjects(std::vector<ObjectInfo*>& objects, 
+                      unsigned int threadCount)
+{
+    std::vector<PropertyInfo*> props;
+
+    for (size_t i=0; i < objects.size(); i++)
+    {
+        const ObjectInfo& o = *objects[i];
+
+        for (uint32 q=0; q < o.numComponents; q++)
+        {
+            const ComponentInfo& c = m_components[o.coffset + q];
+
+            for (uint32 j=0; j < c.numProperties; j++)
+            {
+                props.push_back(&m_properties[c.poffset + j]);
+            }
+        }
+    }
+
+    return accessProperties(props, threadCount);
+}
+
+bool
+Reader::openConcurrentAccess()
+{
+    if (m_header.magic != Header::Magic && m_header.magic != Header::Cigam)
+    {
+        return false;
+    }
+
+    return m_inRAM || m_blocks || openPositional();
+}
+
+bool
+Reader::readAt(uint64 offset, 
+               void* buffer, 
+               size_t bytes, 
+               BlockCursor* cursor) const
+{
+#ifndef GTO_SUPPORT_ZIP
+    (void)cursor;
+#endif
+
+    if (m_inRAM)
+    {
+        if (offset + bytes > m_inRAMSize) return false;
+        memcpy(buffer, m_inRAM + offset, bytes);
+        return true;
+    }
+#ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        return m_blocks->readAt(offset, buffer, bytes, cursor);
+    }
+#endif
+    else if (m_positional && m_positional->isOpen())
+    {
+        return m_positional->read(offset, buffer, bytes);
+    }
+
+    return false;
+}
+
+size_t
+Reader::readChunk(uint64 offset, size_t bytes, size_t elementSize) const
+{
+    //
+    //  How much of bytes at offset to read in one go when swapping
+    //  as we go: whole elements, and for compressed files up to the
+    //  end of the block (rounded up to the next element, the rest of
+    //  that block is kept in a BlockCursor)
+    //
+
+#ifdef GTO_SUPPORT_ZIP
+    if (m_blocks && !m_inRAM)
+    {
+        uint64 end = m_blocks->blockEnd(offset);
+
+        if (end > offset)
+        {
+            size_t n = size_t(std::min(uint64(bytes), end - offset));
+            n = (n + elementSize - 1) / elementSize * elementSize;
+            return std::min(n, bytes);
+        }
+    }
+#else
+    (void)offset;
+    (void)elementSize;
+#endif
+
+    return std::min(SwapChunkSize, bytes);
+}
+
+bool
+Reader::readRecords(uint64 offset, 
+                    size_t step, 
+                    size_t record, 
+                    size_t count, 
+                    char* out) const
+{
+    if (!count) return true;
+
+    if (step == record)
+    {
+        return readAt(offset, out, count * record);
+    }
+
+    //
+    //  All the reads below share one cursor, so a compressed block is
+    //  only inflated once however many records come from it
+    //
+
+    BlockCursor cursor;
+
+    if (step > MaxRecordGap)
+    {
+        //
+        //  Too sparse to read through, one read per record
+        //
+
+        for (size_t i=0; i < count; i++)
+        {
+            if (!readAt(offset + i * step, out + i * record, record, &cursor))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //
+    //  Pull runs of records through a local chunk and keep the
+    //  wanted bytes of each
+    //
+
+    size_t chunkSize = std::max(size_t(1), SwapChunkSize / step);
+    std::vector<char> chunk(chunkSize * step);
+
+    for (size_t r=0; r < count; r += chunkSize)
+    {
+        size_t n = std::min(chunkSize, count - r);
+
+        //
+        //  The last record ends with the wanted bytes
+        //
+
+        size_t span = (n - 1) * step + record;
+
+        if (!readAt(offset + r * step, &chunk.front(), span, &cursor))
+        {
+            return false;
+        }
+
+        for (size_t i=0; i < n; i++)
+        {
+            memcpy(out + (r + i) * record, &chunk[i * step], record);
+        }
+    }
+
+    return true;
+}
+
+bool
+Reader::readPropertyData(const PropertyInfo& p, void* buffer) const
+{
+    return readPropertyData(p, buffer, 0, p.size, 1);
+}
+
+bool
+Reader::readPropertyData(const PropertyInfo& p, 
+                         void* buffer,
+                         size_t begin,
+                         size_t end,
+                         size_t stride) const
+{
+    if (begin > end || end > p.size || !stride) return false;
+
+    size_t ds    = dataSize(p.type);
+    size_t elem  = p.width * ds;
+    size_t count = (end - begin + stride - 1) / stride;
+    char* out    = (char*) buffer;
+
+    if (!count || !elem) return true;
+
+    const ComponentInfo* c = (const ComponentInfo*) p.component;
+
+    if (c && (c->flags & Gto::Transposed))
+    {
+        //
+        //  Each element is one column of a record holding every
+        //  property of the component
+        //
+
+        size_t recordStride = 0;
+
+        for (uint32 i=0; i < c->numProperties; i++)
+        {
+            const PropertyInfo& q = m_properties[c->poffset + i];
+            recordStride += q.width * dataSize(q.type);
+        }
+
+        if (!readRecords(p.offset + begin * recordStride, recordStride * stride,
+                         elem, count, out))
+        {
+            return false;
+        }
+    }
+    else if (p.pad)
+    {
+        //
+        //  Shuffled and delta coded data only decodes whole
+        //
+
+        size_t bytes = size_t(p.size) * elem;
+        std::vector<char> whole(bytes);
+        if (!readAt(p.offset, &whole.front(), bytes)) return false;
+        decodeBuffer(&whole.front(), p, bytes / ds, m_swapped);
+
+        for (size_t i=0; i < count; i++)
+        {
+            memcpy(out + i * elem, &whole[(begin + i * stride) * elem], elem);
+        }
+
+        return true;
+    }
+    else if (stride == 1)
+    {
+        //
+        //  Contiguous: read and swap a chunk (or a compressed block)
+        //  at a time while it's in cache
+        //
+
+        size_t bytes  = count * elem;
+        uint64 offset = p.offset + begin * elem;
+        BlockCursor cursor;
+
+        for (size_t b=0, n=0; b < bytes; b += n)
+        {
+            n = readChunk(offset + b, bytes - b, ds);
+            if (!readAt(offset + b, out + b, n, &cursor)) return false;
+            if (m_swapped) swapBuffer(out + b, p.type, n / ds);
+        }
+
+        return true;
+    }
+    else if (!readRecords(p.offset + begin * elem, elem * stride, 
+                          elem, count, out))
+    {
+        return false;
+    }
+
+    if (m_swapped) swapBuffer(out, p.type, count * p.width);
+    return true;
+}
+
+bool
+Reader::readTextGTO()
+{
+    m_header.magic = Header::MagicText;
+
+    //
+    //  The parser works on the whole file in memory. In-RAM input is
+    //  used as is, streams are read in large chunks.
+    //
+
+    ByteArray text;
+    const char* begin = 0;
+    const char* end = 0;
+
+    if (m_inRAM)
+    {
+        begin = m_inRAM + m_inRAMCurrentPos;
+        end   = m_inRAM + m_inRAMSize;
+    }
+    else if (m_in)
+    {
+        const size_t chunk = 1 << 20;
+        size_t n = 0;
+
+        while (*m_in)
+        {
+            text.resize(n + chunk);
+            m_in->read((char*)&text[n], chunk);
+            n += size_t(m_in->gcount());
+        }
+
+        text.resize(n);
+
+        if (n)
+        {
+            begin = (const char*)&text.front();
+            end   = begin + n;
+        }
+    }
+
+    TextParser parser(this, begin, end, (m_mode & ParallelText) != 0);
+
+    if (!parser.parse())
+    {
+        fail("failed to parse text GTO");
+        return false;
+    }
+    
+    header(m_header);
+    descriptionComplete();
+    return true;
+}
+
+namespace {
+
+//
+//  A parsed description as it is before any callbacks: nothing
+//  requested and the info pointers unset. dataOffset is where the
+//  property data starts.
+//
+
+struct Description
+{
+    uint64              time;
+    uint64              size;
+    uint64              dataOffset;
+    bool                swapped;
+    Header              header;
+    Reader::StringTable strings;
+    Reader::StringMap   stringMap;
+    Reader::Objects     objects;
+    Reader::Components  components;
+    Reader::Properties  properties;
+};
+
+//
+//  The cache holds at most MaxCachedDescriptions files. When it is
+//  full the least recently used one is dropped: descriptionOrder
+//  lists the paths most recently used first and each entry keeps its
+//  position in it.
+//
+
+typedef std::list<std::string> DescriptionOrder;
+
+struct CachedDescriptionEntry
+{
+    std::shared_ptr<const Description>  description;
+    DescriptionOrder::iterator          order;
+};
+
+typedef std::map<std::string, CachedDescriptionEntry> DescriptionCache;
+
+static const size_t MaxCachedDescriptions = 1024;
+
+std::mutex          descriptionMutex;
+DescriptionCache    descriptionCache;
+DescriptionOrder    descriptionOrder;
+
+} // namespace
+
+void
+Reader::clearDescriptionCache()
+{
+    std::lock_guard<std::mutex> guard(descriptionMutex);
+    descriptionCache.clear();
+    descriptionOrder.clear();
+}
+
+bool
+Reader::readCachedDescription()
+{
+    if (!(m_mode & CachedDescription) || !m_needsClosing || m_inName.empty())
+    {
+        return false;
+    }
+
+    std::shared_ptr<const Description> d;
+
+    {
+        std::lock_guard<std::mutex> guard(descriptionMutex);
+        DescriptionCache::iterator i = descriptionCache.find(m_inName);
+
+        if (i != descriptionCache.end())
+        {
+            d = i->second.description;
+            descriptionOrder.splice(descriptionOrder.begin(), 
+                                    descriptionOrder, i->second.order);
+        }
+    }
+
+    if (!d || d->time != m_inTime || d->size != m_inSize) return false;
+
+    //
+    //  The magic number has been read already
+    //
+
+    seekForward(size_t(d->dataOffset - sizeof(uint32)));
+    if (m_error) return false;
+
+    m_header     = d->header;
+    m_swapped    = d->swapped;
+    m_strings    = d->strings;
+    m_stringMap  = d->stringMap;
+    m_objects    = d->objects;
+    m_components = d->components;
+    m_properties = d->properties;
+
+    for (size_t i=0; i < m_objects.size(); i++)
+    {
+        const ObjectInfo& o = m_objects[i];
+
+        for (uint32 q=0; q < o.numComponents; q++)
+        {
+            m_components[o.coffset + q].object = &o;
+        }
+    }
+
+    for (size_t i=0; i < m_components.size(); i++)
+    {
+        const ComponentInfo& c = m_components[i];
+
+        for (uint32 q=0; q < c.numProperties; q++)
+        {
+            m_properties[c.poffset + q].component = &c;
+        }
+    }
+
+    //
+    //  Ask the same questions in the same order as the parser does
+    //
+
+    header(m_header);
+    if (m_mode & RandomAccess) return true;
+
+    for (Objects::iterator i = m_objects.begin(); i != m_objects.end(); ++i)
     {
-        return false;
+        ObjectInfo& o = *i;
+        Request r = object(stringFromId(o.name), 
+                           stringFromId(o.protocolName), 
+                           o.protocolVersion,
+                           o);
+        o.requested  = r.m_want;
+        o.objectData = r.m_data;
     }
-}
 
-bool
-Reader::accessComponent(ComponentInfo& c, bool queryUp)
-{
-    if (queryComponent(c, queryUp))
+    for (Components::iterator i = m_components.begin(); i != m_components.end(); ++i)
     {
-        for (uint32 j=0; j < c.numProperties; j++)
-        {
-            PropertyInfo& p = m_properties[c.poffset + j];
-            if (!accessProperty(p, false))
-            {
-                return false;
-            }
-        }
-        return true;
+        ComponentInfo& c = *i;
+        if (!c.object->requested) continue;
+
+        Request r = component(stringFromId(c.name), 
+                              stringFromId(c.interpretation),
+                              c);
+        c.requested     = r.m_want;
+        c.componentData = r.m_data;
     }
-    else
+
+    for (Properties::iterator i = m_properties.begin(); i != m_properties.end(); ++i)
     {
-        return false;
+        PropertyInfo& p = *i;
+        if (!p.component->requested) continue;
+
+        Request r = property(stringFromId(p.name), 
+                             stringFromId(p.interpretation),
+                             p);
+        p.requested    = r.m_want;
+        p.propertyData = r.m_data;
     }
-}
 
-bool
-Reader::accessComponent(ComponentInfo& c)
-{
-    return accessComponent(c, true);
+    return true;
 }
 
-bool
-Reader::queryObject(ObjectInfo &o)
+void
+Reader::cacheDescription()
 {
-    Request r = object(stringFromId(o.name), 
-                       stringFromId(o.protocolName), 
-                       o.protocolVersion,
-                       o);
+    if (!(m_mode & CachedDescription) || !m_needsClosing || m_inName.empty())
+    {
+        return;
+    }
 
-    o.requested = r.m_want;
-    o.objectData = r.m_data;
+    //
+    //  Cached descriptions always hold decoded strings
+    //
 
-    return o.requested;
-}
+    stringTable();
+    buildStringMap();
 
-bool
-Reader::accessObject(ObjectInfo& o)
-{
-    if (queryObject(o))
+    std::shared_ptr<Description> d(new Description);
+    d->time       = m_inTime;
+    d->size       = m_inSize;
+    d->dataOffset = tell();
+    d->swapped    = m_swapped;
+    d->header     = m_header;
+    d->strings    = m_strings;
+    d->stringMap  = m_stringMap;
+    d->objects    = m_objects;
+    d->components = m_components;
+    d->properties = m_properties;
+
+    for (size_t i=0; i < d->objects.size(); i++)
     {
-        for (uint32 q=0; q < o.numComponents; q++)
-        {
-            assert( (o.coffset+q) < m_components.size() );
+        d->objects[i].requested  = false;
+        d->objects[i].objectData = 0;
+    }
 
-            ComponentInfo& c = m_components[o.coffset + q];
-            if (!accessComponent(c, false))
-            {
-                return false;
-            }
-        }
-        return true;
+    for (size_t i=0; i < d->components.size(); i++)
+    {
+        d->components[i].requested     = false;
+        d->components[i].componentData = 0;
+        d->components[i].object        = 0;
     }
-    else
+
+    for (size_t i=0; i < d->properties.size(); i++)
     {
-        return false;
+        d->properties[i].requested    = false;
+        d->properties[i].propertyData = 0;
+        d->properties[i].component    = 0;
     }
-}
 
-bool
-Reader::readTextGTO()
-{
-    m_header.magic = Header::MagicText;
+    std::lock_guard<std::mutex> guard(descriptionMutex);
+    DescriptionCache::iterator i = descriptionCache.find(m_inName);
 
-    if (!::GTOParse(this))
+    if (i != descriptionCache.end())
     {
-        fail("failed to parse text GTO");
-        return false;
+        descriptionOrder.splice(descriptionOrder.begin(), 
+                                descriptionOrder, i->second.order);
     }
-    
-    header(m_header);
-    descriptionComplete();
-    return true;
+    else
+    {
+        if (descriptionCache.size() >= MaxCachedDescriptions)
+        {
+            descriptionCache.erase(descriptionOrder.back());
+            descriptionOrder.pop_back();
+        }
+
+        descriptionOrder.push_front(m_inName);
+        i = descriptionCache.insert(std::make_pair(m_inName, 
+                                                   CachedDescriptionEntry())).first;
+        i->second.order = descriptionOrder.begin();
+    }
+
+    i->second.description = d;
 }
 
 bool
 Reader::readBinaryGTO()
 {
-    readIndexTable();      // OK to continue if this fails
-    readHeader();           if (m_error) return false; 
-    readStringTable();      if (m_error) return false;
-    readObjects();          if (m_error) return false;
-    readComponents();       if (m_error) return false;
-    readProperties();       if (m_error) return false;
+    if (!readCachedDescription())
+    {
+        if (m_error) return false;
+        readHeader();           if (m_error) return false; 
+
+        uint64 dataStart = 0;
+
+        if (m_header.version == GTO_VERSION_STREAMED)
+        {
+            dataStart = tell();
+            if (!seekToStreamDescription()) return false;
+        }
+
+        readStringTable();      if (m_error) return false;
+        readObjects();          if (m_error) return false;
+        readComponents();       if (m_error) return false;
+        readProperties();       if (m_error) return false;
+
+        if (dataStart) seekTo(dataStart);
+        cacheDescription();
+    }
+
     descriptionComplete();
 
     if (m_mode & HeaderOnly)
@@ -977,6 +2386,27 @@ Reader::readBinaryGTO()
         return true;
     }
 
+    //
+    //  Everything that will be handed to data() is known now so
+    //  allocateData() can get it all in one slab
+    //
+
+    m_requestedBytes = 0;
+
+    if (!(m_mode & RandomAccess))
+    {
+        for (size_t i=0; i < m_properties.size(); i++)
+        {
+            const PropertyInfo& p = m_properties[i];
+
+            if (p.requested)
+            {
+                m_requestedBytes += Arena::roundUp(size_t(p.size) * p.width * 
+                                                   dataSize(p.type));
+            }
+        }
+    }
+
     Properties::iterator p = m_properties.begin();
 
     for (Components::iterator i = m_components.begin();
@@ -987,11 +2417,15 @@ Reader::readBinaryGTO()
             
         if (comp.flags & Gto::Transposed)
         {
-            cerr << "ERROR: Transposed data for '"
-                 << stringFromId( comp.object->name ) << "."
-                 << stringFromId( comp.name ) 
-                 << "' is currently unsupported." << endl;
-            abort();
+            std::vector<PropertyInfo*> wanted;
+
+            for (Properties::iterator e = p + comp.numProperties; p != e; ++p)
+            {
+                if (p->requested) wanted.push_back(&*p);
+            }
+
+            readTransposed(comp, wanted);
+            if (m_error) return false;
         }
         else
         {
@@ -1010,10 +2444,101 @@ Reader::readBinaryGTO()
     return true;
 }
 
+size_t
+Reader::readTransposed(ComponentInfo& c, 
+                       const std::vector<PropertyInfo*>& wanted)
+{
+    if (!c.numProperties) return 0;
+
+    //
+    //  Every element is a record holding each property's values in
+    //  turn, so all the properties must have the same size
+    //
+
+    Properties::iterator first = m_properties.begin() + c.poffset;
+    size_t count = first->size;
+    size_t stride = 0;
+    std::vector<size_t> columns(c.numProperties);
+
+    for (size_t i=0; i < c.numProperties; i++)
+    {
+        if (first[i].size != count)
+        {
+            fail("transposed component has properties of different sizes");
+            return 0;
+        }
+
+        columns[i] = stride;
+        stride += first[i].width * dataSize(first[i].type);
+    }
+
+    if (m_currentReadOffset == 0) m_currentReadOffset = tell();
+
+    uint64 start = m_currentReadOffset;
+    for (size_t i=0; i < c.numProperties; i++) first[i].offset = start + columns[i];
+
+    std::vector<PropertyInfo*> props;
+    std::vector<char*> buffers;
+
+    for (size_t i=0; i < wanted.size(); i++)
+    {
+        PropertyInfo& p = *wanted[i];
+        size_t bytes = size_t(p.size) * p.width * dataSize(p.type);
+
+        if (char* buffer = (char*) data(p, bytes))
+        {
+            props.push_back(&p);
+            buffers.push_back(buffer);
+        }
+    }
+
+    if (!props.empty() && stride && count)
+    {
+        uint64 pos = tell();
+        if (start != pos) seekForward(size_t(start - pos));
+
+        //
+        //  Read whole records a chunk at a time and scatter them to the
+        //  property buffers, swapping while the data is in cache
+        //
+
+        size_t chunkSize = std::max(size_t(1), SwapChunkSize / stride);
+        std::vector<char> chunk(chunkSize * stride);
+
+        for (size_t r=0; r < count; r += chunkSize)
+        {
+            size_t n = std::min(chunkSize, count - r);
+            read(&chunk.front(), n * stride);
+            if (m_error) break;
+
+            for (size_t i=0; i < props.size(); i++)
+            {
+                const PropertyInfo& p = *props[i];
+                size_t es         = p.width * dataSize(p.type);
+                const char* src   = &chunk.front() + (p.offset - start);
+                char* dst         = buffers[i] + r * es;
+
+                for (size_t q=0; q < n; q++) 
+                {
+                    memcpy(dst + q * es, src + q * stride, es);
+                }
+
+                if (m_swapped) swapBuffer(dst, p.type, n * p.width);
+            }
+        }
+    }
+
+    m_currentReadOffset = start + uint64(stride) * count;
+    if (m_error) return 0;
+
+    for (size_t i=0; i < props.size(); i++) dataRead(*props[i]);
+    return props.size();
+}
+
 bool
 Reader::readProperty(PropertyInfo& prop)
 {
-    size_t num   = prop.size * prop.width;
+    size_t num   = size_t(prop.size) * prop.width;
     size_t bytes = num * dataSize(prop.type);
     char* buffer = 0;
 
@@ -1028,28 +2553,57 @@ Reader::readProperty(PropertyInfo& prop)
         m_currentReadOffset = tell();
     }
 
-    prop.offset = (unsigned int) m_currentReadOffset;
+    prop.offset = m_currentReadOffset;
     bool readok = false;
 
     if (prop.requested)
     {
+        //
+        //  In-memory data that needs no swapping can be given away as
+        //  is. If the reader doesn't take it we fall through and copy.
+        //
+
+        if (m_inRAM && !m_swapped && !prop.pad && bytes &&
+            m_currentReadOffset + bytes <= m_inRAMSize &&
+            dataMapped(prop, m_inRAM + m_currentReadOffset, bytes))
+        {
+            m_currentReadOffset += bytes;
+            dataRead(prop);
+            return true;
+        }
+
         buffer = (char*) data(prop, bytes);
         if (buffer)
         {
-            if(prop.index < m_dataOffsets.size())
+            // Do we need to be somewhere else?
+            uint64 pos = tell();
+            if(m_currentReadOffset != pos)
             {
-                seekTo(prop);
+                // If so, move the actual file pointer there.
+                seekForward(size_t(m_currentReadOffset - pos));
             }
-            else
+
+            if (m_swapped && !prop.pad)
             {
-                // Do we need to be somewhere else?
-                if(int(m_currentReadOffset) != tell())
+                //
+                //  Swap each chunk right after reading it while it's
+                //  still in cache
+                //
+
+                size_t ds = dataSize(prop.type);
+
+                for (size_t i=0; i < bytes && !m_error; i += SwapChunkSize)
                 {
-                    // If so, move the actual file pointer there.
-                    seekForward(m_currentReadOffset - tell());
+                    size_t n = std::min(SwapChunkSize, bytes - i);
+                    read(buffer + i, n);
+                    swapBuffer(buffer + i, prop.type, n / ds);
                 }
             }
-            read(buffer, bytes);
+            else
+            {
+                read(buffer, bytes);
+            }
+
             readok = true;
         }
     }
@@ -1062,31 +2616,7 @@ Reader::readProperty(PropertyInfo& prop)
 
     if (readok)
     {
-        if (m_swapped)
-        {
-            switch (prop.type)
-            {
-              case Gto::Int: 
-              case Gto::String:
-              case Gto::Float: 
-                  swapWords(buffer, num);
-                  break;
-                          
-              case Gto::Short:
-              case Gto::Half: 
-                  swapShorts(buffer, num);
-                  break;
-                          
-              case Gto::Double: 
-                  swapWords(buffer, num * 2);
-                  break;
-                          
-              case Gto::Byte:
-              case Gto::Boolean: 
-                  break;
-            }
-        }
-
+        if (prop.pad) decodeBuffer(buffer, prop, num, m_swapped);
         dataRead(prop);
     }
 
@@ -1107,6 +2637,10 @@ Reader::notEOF()
         return (!m_in->eof());
     }
 #ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        return !m_blocks->eof();
+    }
     else if (m_gzfile)
     {
         return m_gzrval != -1;
@@ -1129,11 +2663,8 @@ Reader::read(char *buffer, size_t size)
             past_eof = true;
         }
 
-        for (size_t i=0; i<size; i++)
-        {
-            buffer[i] = m_inRAM[m_inRAMCurrentPos];
-            m_inRAMCurrentPos++;
-        }
+        memcpy(buffer, m_inRAM + m_inRAMCurrentPos, size);
+        m_inRAMCurrentPos += size;
 
         if (past_eof)
         {
@@ -1156,13 +2687,25 @@ Reader::read(char *buffer, size_t size)
     }
 
 #ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        if (m_blocks->read(buffer, size) != size)
+        {
+            std::cerr << "ERROR: Gto::Reader: Failed to read gto file: '";
+            std::cerr << m_inName << "': " << std::endl;
+            memset( buffer, 0, size );
+            fail( "block read fail" );
+        }
+    }
     else if (m_gzfile)
     {
         char *buffer_pos = buffer;
         size_t remaining = size;
         while (remaining != 0)
         {
-            int retval = gzread( (gzFile)m_gzfile, buffer_pos, (unsigned)remaining );
+            // gzread() can only return an int worth of bytes at a time
+            unsigned chunk = remaining > (1u << 30) ? (1u << 30) : unsigned(remaining);
+            int retval = gzread( (gzFile)m_gzfile, buffer_pos, chunk );
             if (retval <= 0)
             {
                 int zError = 0;
@@ -1200,6 +2743,10 @@ Reader::get(char &c)
         m_in->get(c);
     }
 #ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        if (m_blocks->read(&c, 1) != 1) c = 0;
+    }
     else if (m_gzfile)
     {
         m_gzrval = gzgetc( (gzFile)m_gzfile );
@@ -1217,7 +2764,9 @@ void Reader::fail( std::string why )
 const std::string& Reader::stringFromId(unsigned int i) const
 {
     static std::string empty( "" );
-    return (i >= m_strings.size() ? empty : m_strings[i]);
+    if (i >= m_strings.size()) return empty;
+    decodeString(i);
+    return m_strings[i];
 }
 
 const std::string& Reader::stringFromId(unsigned int i)
@@ -1231,6 +2780,7 @@ const std::string& Reader::stringFromId(unsigned int i)
         return empty;
     }
 
+    decodeString(i);
     return m_strings[i];
 }
 
@@ -1253,43 +2803,49 @@ void Reader::seekForward(size_t bytes)
 #endif
     }
 #ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        m_blocks->seek(m_blocks->tell() + bytes);
+    }
     else
     {
-        gzseek( (gzFile)m_gzfile, (unsigned)bytes, SEEK_CUR );
+        gzseek( (gzFile)m_gzfile, z_off_t(bytes), SEEK_CUR );
     }
 #endif
 }
 
 void Reader::seekTo(const PropertyInfo &p)
 {
-    size_t bytes = p.offset;
+    seekTo(p.offset);
+}
+
+void Reader::seekTo(uint64 offset)
+{
+    uint64 bytes = offset;
     if (m_inRAM)
     {
         if (bytes > m_inRAMSize)
         {
             bytes = m_inRAMSize;
         }
-        m_inRAMCurrentPos = bytes;
+        m_inRAMCurrentPos = size_t(bytes);
     }
     else if (m_in)
     {
 #ifdef HAVE_FULL_IOSTREAMS
-        m_in->seekg(bytes, ios_base::beg);
+        m_in->seekg(streamoff(bytes), ios_base::beg);
 #else
-        m_in->seekg(bytes, ios::beg);
+        m_in->seekg(streamoff(bytes), ios::beg);
 #endif
     }
 #ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        m_blocks->seek(offset);
+    }
     else
     {
-        if(p.index < m_dataOffsets.size())
-        {
-            gzseek_raw( (gzFile)m_gzfile, m_dataOffsets[p.index] );
-        }
-        else
-        {
-            gzseek( (gzFile)m_gzfile, p.offset, SEEK_SET );
-        }
+        gzseek( (gzFile)m_gzfile, z_off_t(offset), SEEK_SET );
     }
 #endif
 
@@ -1299,20 +2855,24 @@ void Reader::seekTo(const PropertyInfo &p)
     m_currentReadOffset = tell();
 }
 
-int Reader::tell()
+uint64 Reader::tell()
 {
     if (m_inRAM)
     {
-        return int(m_inRAMCurrentPos);
+        return uint64(m_inRAMCurrentPos);
     }
     else if (m_in)
     {
-        return int(m_in->tellg());
+        return uint64(streamoff(m_in->tellg()));
     }
 #ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        return m_blocks->tell();
+    }
     else
     {
-        return gztell( (gzFile)m_gzfile );
+        return uint64(gztell( (gzFile)m_gzfile ));
     }
 #else
     else
@@ -1401,7 +2961,7 @@ void Reader::beginObject(unsigned int name,
     info.protocolVersion = version;
     info.numComponents   = 0;
     info.pad             = 0;
-    info.coffset         = 0;
+    info.coffset         = int(m_components.size());
 
     Request r = object(stringFromId(name),
                        stringFromId(proto),
@@ -1424,7 +2984,7 @@ void Reader::beginComponent(unsigned int name,
     info.flags          = 0;
     info.interpretation = interp;
     info.pad            = 0;
-    info.poffset        = 0;
+    info.poffset        = int(m_properties.size());
     info.object         = &m_objects.back();
 
     m_objects.back().numComponents++;
@@ -1464,6 +3024,7 @@ void Reader::beginProperty(unsigned int name,
     m_components.back().numProperties++;
 
     m_buffer.clear();
+    if (size) m_buffer.reserve(size_t(size) * width * dataSize(type));
 
     m_currentType.type  = type;
     m_currentType.size  = size;
@@ -1531,24 +3092,32 @@ void Reader::parseWarning(const char* msg)
 }
 
 void Reader::endProperty()
+{
+    textPropertyData(m_properties.back(), m_buffer);
+    m_buffer.clear();
+}
+
+void Reader::textPropertyData(PropertyInfo& info, const ByteArray& bytes)
 {
     //
     //  Give the data to the reader sub-class
     //
 
-    PropertyInfo& info = m_properties.back();
-    info.size = Gto::uint32(numElementsInBuffer());
+    size_t elementSize = dataSize(info.type) * info.width;
+    info.size = Gto::uint32(elementSize ? bytes.size() / elementSize : 0);
 
     if (info.requested)
     {
-        if (void* buffer = data(info, m_buffer.size()))
+        if (void* buffer = data(info, bytes.size()))
         {
-            memcpy(buffer, &m_buffer.front(), m_buffer.size());
+            if (!bytes.empty())
+            {
+                memcpy(buffer, &bytes.front(), bytes.size());
+            }
+
             dataRead(info);
         }
     }
-
-    m_buffer.clear();
 }
 
 void Reader::endFile()
@@ -1556,89 +3125,4 @@ void Reader::endFile()
     m_header.numStrings = Gto::uint32(m_strings.size());
 }
 
-
-void Reader::readIndexTable()
-{
-#ifdef GTO_SUPPORT_ZIP
-    // See zhacks.h for details
-
-    m_dataOffsets.clear();
-    
-    FILE *file = fopen(m_inName.c_str(), "rb");
-
-    //
-    // Read the FLG header field
-    //
-    unsigned char flags = 0;
-    fseek(file, 3L, SEEK_SET);
-    fread(&flags, sizeof(unsigned char), 1, file);
-    if ( ! (flags & EXTRA_FIELD) )
-    {
-        // No offsets in this file
-        fclose(file);
-        return;
-    }
-
-    // According to RFC 1952, gzip header byte order is always little-endian
-
-    //
-    // Read the XLEN extra field length
-    //
-    unsigned char xlen_bytes[2];
-    fseek(file, 10L, SEEK_SET);
-    fread(xlen_bytes, sizeof(unsigned char), 2, file);
-    unsigned short xlen = xlen_bytes[0] + (xlen_bytes[1] << 8);
-
-    if( xlen != (2 * sizeof(unsigned int)) )
-    {
-        std::cerr << "Warning: ignoring malformed index table." << std::endl;
-        fclose(file);
-        return;
-    }
-
-    //
-    // Read the index table offset and size
-    //
-    unsigned int indexTableOffset = 0;
-    unsigned int indexTableSize = 0;
-    fread(&indexTableOffset, sizeof(unsigned int), 1, file);
-    fread(&indexTableSize, sizeof(unsigned int), 1, file);
-    fclose(file);
-
-    unsigned short needsSwap = 0xFF00;
-    if( *(unsigned char*)(&needsSwap) )
-    {
-        swapWords(&indexTableOffset, 1);
-        swapWords(&indexTableSize, 1);
-    }
-    
-    //
-    // Read the offset table
-    //
-    m_dataOffsets.resize(indexTableSize);
-    unsigned int restore_gz_pos = gztell( (gzFile)m_gzfile );
-    gzseek_raw( (gzFile)m_gzfile, indexTableOffset );
-    /*int r =*/ gzread( (gzFile)m_gzfile, &m_dataOffsets.front(), indexTableSize * sizeof(unsigned int));
-
-    //
-    // Offsets are always stored as little-endian
-    //
-    if( *(unsigned char*)(&needsSwap) )
-    {
-        swapWords(&m_dataOffsets.front(), m_dataOffsets.size());
-    }
-
-    //
-    // Rewind and seek past the GTO magic number
-    //
-    // Note: I can't figure out how to reset the gzip stream
-    // to 'normal' after a gzseek_raw, so I'm closing and re-
-    // opening it.
-    //
-    gzclose( (gzFile)m_gzfile );
-    m_gzfile = gzopen( m_inName.c_str(), "rb" );
-    gzseek( (gzFile)m_gzfile, restore_gz_pos, SEEK_SET );
-#endif
-}
-
 } // Gto
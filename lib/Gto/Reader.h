@@ -40,12 +40,16 @@
 
 #include <Gto/Header.h>
 #include <Gto/Utilities.h>
+#include <Gto/Pattern.h>
+#include <Gto/Arena.h>
 #include <iostream>
 #include <map>
 #include <string>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <list>
+#include <string.h>
 
 #if defined(None) && defined(X_H)
 // WARNING: You included X.h which defines None
@@ -53,10 +57,13 @@
 #undef None
 #endif
 
-class GTOFlexLexer;
-
 namespace Gto {
 
+class PositionalFile;
+class TextParser;
+class BlockReader;
+class BlockCursor;
+
 //
 //  class Reader
 //
@@ -74,7 +81,7 @@ public:
     struct ObjectInfo;
     struct ComponentInfo;
     struct PropertyInfo;
-    friend class ::GTOFlexLexer;   // for ascii parser
+    friend class TextParser;       // for ascii parser
 
     struct GTO_API ObjectInfo : ObjectHeader
     {
@@ -104,7 +111,7 @@ public:
     struct GTO_API PropertyInfo : PropertyHeader
     {
         void*                propertyData;
-        unsigned int         offset;    // file offset
+        uint64               offset;    // file offset
 
         const ComponentInfo* component;
 
@@ -119,8 +126,10 @@ public:
     typedef std::vector<PropertyInfo>  Properties;
     typedef std::vector<std::string>   StringTable;
     typedef std::vector<unsigned char> ByteArray;
-    typedef std::map<std::string,int>  StringMap;
-    typedef std::vector<unsigned int>  DataOffsets;
+    typedef std::unordered_map<std::string,int> StringMap;
+    typedef std::unordered_map<uint64,int>      NameIndex;
+    typedef std::vector<uint64>        DataOffsets;
+    typedef std::vector<int>           Indices;
 
 
     //
@@ -146,6 +155,30 @@ public:
     //  this as many times as you want using the accessObject()
     //  function. RandomAccess implies BinaryOnly.
     //
+    //  MemoryMapped: uncompressed binary files opened by name are
+    //  mapped into memory instead of being read through a stream.
+    //  Property data is handed to dataMapped() as a pointer into the
+    //  mapping when the file does not need to be byte swapped. Text
+    //  and compressed files are read normally.
+    //
+    //  CachedDescription: the parsed header, string table and
+    //  object/component/property descriptions of binary files opened
+    //  by name are kept in a process wide cache (keyed on the path,
+    //  modification time and size) and reused by later opens of the
+    //  same file from any Reader with this flag. The callbacks are
+    //  called just as if the file had been parsed. Up to 1024 files
+    //  are cached; beyond that the least recently used is dropped.
+    //
+    //  LazyStrings: the string table of binary files is kept as one
+    //  block and strings are only decoded when they are asked for.
+    //  Opening files with huge string tables is much cheaper when
+    //  only a few strings are used. stringTable() decodes them all.
+    //
+    //  ParallelText: large numeric properties of text files are
+    //  converted on all cores after the rest of the file has been
+    //  parsed. All data() calls then come after the declarations
+    //  (as with binary files), still in file order and from the
+    //  calling thread.
     //
 
     enum ReadMode
@@ -155,6 +188,10 @@ public:
         RandomAccess     = 1 << 1,
         BinaryOnly       = 1 << 2,
         TextOnly         = 1 << 3,
+        MemoryMapped     = 1 << 4,
+        CachedDescription = 1 << 5,
+        LazyStrings      = 1 << 6,
+        ParallelText     = 1 << 7,
     };
 
     explicit Reader(unsigned int mode = None);
@@ -178,6 +215,12 @@ public:
                              unsigned int ormode = 0);
     void                close();
 
+    //
+    //  Empties the CachedDescription cache
+    //
+
+    static void         clearDescriptionCache();
+
     //
     //  If it failed. why() will return a description.
     //
@@ -186,10 +229,10 @@ public:
     const std::string&  why() const { return m_why; }
 
     const std::string&  stringFromId(unsigned int i);
-    const StringTable&  stringTable() { return m_strings; }
+    const StringTable&  stringTable();
 
     bool                isSwapped() const { return m_swapped; }
-    bool                hasIndex() const { return !m_dataOffsets.empty(); }
+    bool                hasIndex() const { return m_blocks != 0; }
     unsigned int        readMode() const { return m_mode; }
 
     const std::string&  infileName() const { return m_inName; }
@@ -200,6 +243,15 @@ public:
 
     Header&             fileHeader() { return m_header; }
 
+    //
+    //  Hands the arena used by allocateData() to the caller, who
+    //  must delete it once the data is no longer needed. Returns 0 if
+    //  nothing was allocated. The next allocateData() starts a new
+    //  arena.
+    //
+
+    Arena*              releaseArena();
+
     //
     //  This function is called right after the file header is read. 
     //
@@ -236,6 +288,56 @@ public:
     Properties&         properties() { return m_properties; }
     bool                accessProperty(PropertyInfo&);
 
+    //
+    //  Batch versions of accessProperty() and accessObject(). The
+    //  requests are made exactly as the single versions would make
+    //  them, then the data is read and byte swapped on up to
+    //  threadCount threads (0 means one per core). All of the virtual
+    //  functions (object(), property(), data(), dataRead(), etc) are
+    //  still called from the calling thread only. Uncompressed and
+    //  block compressed files opened by name and in-memory files are
+    //  read concurrently; anything else is read sequentially in file
+    //  order. Returns the number of properties whose data was read.
+    //
+
+    size_t              accessProperties(std::vector<PropertyInfo*>&,
+                                         unsigned int threadCount = 0);
+    size_t              accessObjects(std::vector<ObjectInfo*>&,
+                                      unsigned int threadCount = 0);
+
+    //
+    //  Thread safe random access. Call openConcurrentAccess() once
+    //  after open() (RandomAccess mode is the usual case); if it
+    //  returns true readPropertyData() can then be called on one
+    //  Reader from any number of threads at once. Every read names
+    //  its own file offset so there is no shared cursor and none of
+    //  the virtual functions are called: the data is read, unfiltered
+    //  and byte swapped straight into buffer, which must hold
+    //  size * width * dataSize(type) bytes. Uncompressed and block
+    //  compressed binary files opened by name and in-memory binary
+    //  files are supported. Don't call anything else that reads from
+    //  the file while reads are in flight.
+    //
+
+    bool                openConcurrentAccess();
+    bool                readPropertyData(const PropertyInfo&, void* buffer) const;
+
+    //
+    //  Reads part of a property the same way: the elements (width
+    //  values each) begin, begin + stride, ... up to but not
+    //  including end. buffer must hold that many elements. Only the
+    //  requested range is read from uncompressed files and only the
+    //  blocks that hold it from block compressed ones; filtered
+    //  properties are read and decoded whole. Returns false if the
+    //  range is outside the property.
+    //
+
+    bool                readPropertyData(const PropertyInfo&, 
+                                         void* buffer,
+                                         size_t begin,
+                                         size_t end,
+                                         size_t stride = 1) const;
+
     // Information query API
 
     inline const ObjectInfo& objectAt(int i) const { return m_objects[i]; }
@@ -246,7 +348,9 @@ public:
     inline ComponentInfo& componentAt(int i) { return m_components[i]; }
     inline PropertyInfo& propertyAt(int i) { return m_properties[i]; }
 
-    // All of the following methods return -1 if given object, component or property cannot be found
+    // All of the following methods return -1 if given object, component or property cannot be found.
+    // They use a hash index built on first use; make the first call before sharing the reader
+    // between threads.
     int findObject(const std::string &name) const;
     int findComponent(const ObjectInfo &o, const std::string &name) const;
     int findComponent(const std::string &oname, const std::string &cname) const;
@@ -325,6 +429,12 @@ public:
     size_t findProperties(const ObjectInfo &o, const std::string &c, const std::string &pattern, std::vector<std::string> &names) const;
     size_t findProperties(const std::string &o, const std::string &c, const std::string &pattern, std::vector<std::string> &names) const;
 
+    // Same with a precompiled Pattern. These fill in indices for objectAt(), componentAt() and
+    // propertyAt() instead of copying names.
+    size_t findObjects(const Pattern &pattern, Indices &indices) const;
+    size_t findComponents(const ObjectInfo &o, const Pattern &pattern, Indices &indices) const;
+    size_t findProperties(const ComponentInfo &c, const Pattern &pattern, Indices &indices) const;
+
     //
     //  These are used to declare a component or property. The
     //  functions are called expecting the return value to be non-zero
@@ -395,6 +505,20 @@ public:
 
     virtual void        dataRead(const PropertyInfo&);
 
+    //
+    //  dataMapped() is called instead of data() when the property
+    //  bytes are already in memory in their final form (MemoryMapped
+    //  mode or the in-RAM open(), and the file is not swapped). The
+    //  pointer stays valid until close() and is not guaranteed to be
+    //  aligned for the property type. Return true if you took the
+    //  data, in which case dataRead() follows; return false to fall
+    //  back to data() and have the bytes copied.
+    //
+
+    virtual bool        dataMapped(const PropertyInfo&,
+                                   const void* data,
+                                   size_t bytes);
+
     //------------------------------------------------------------
     //
     //  Text file parser
@@ -454,6 +578,28 @@ protected:
 
     virtual bool        readProperty(PropertyInfo&);
 
+    //
+    //  Reads a Transposed component, whose properties are stored
+    //  interleaved element by element, in one pass starting at the
+    //  current position. Only the given properties are handed to
+    //  data(); all of them get their offset set. Returns the number
+    //  of properties read.
+    //
+
+    size_t              readTransposed(ComponentInfo&, 
+                                       const std::vector<PropertyInfo*>&);
+
+    //
+    //  Allocation hook for data() overrides: returns 16 byte aligned
+    //  memory from an arena owned by the Reader. When the whole file
+    //  is read the arena is sized up front from the requested
+    //  properties so they all land in one slab. The memory lives
+    //  until the Reader is destroyed or releaseArena() is called;
+    //  don't delete it.
+    //
+
+    void*               allocateData(size_t bytes);
+
     //  Const variant of stringFromId for query API
     const std::string&  stringFromId(unsigned int i) const;
 
@@ -470,35 +616,61 @@ protected:
 private:
     bool                readBinaryGTO();
     bool                readTextGTO();
+    void                textPropertyData(PropertyInfo&, const ByteArray&);
     void                readMagicNumber();
     void                readHeader();
     void                readStringTable();
     void                readObjects();
     void                readComponents();
     void                readProperties();
-    void                readIndexTable();
+    bool                readCachedDescription();
+    void                cacheDescription();
+    bool                openMapped(const char*);
+    bool                openPositional();
+    bool                readAt(uint64 offset, void* buffer, size_t bytes,
+                               BlockCursor* cursor = 0) const;
+    size_t              readChunk(uint64 offset, size_t bytes, 
+                                  size_t elementSize) const;
+    bool                readRecords(uint64 offset, size_t step, size_t record,
+                                    size_t count, char* out) const;
+    void                indexNames() const;
+    void                readStringBlock();
+    void                decodeString(unsigned int) const;
+    void                buildStringMap() const;
 
     void                read(char *, size_t);
     void                get(char &);
     bool                notEOF();
     void                seekForward(size_t);
-    int                 tell();
+    uint64              tell();
     void                seekTo(const PropertyInfo &p);
+    void                seekTo(uint64 offset);
+    bool                seekToStreamDescription();
 
 private:
     Header              m_header;
     Objects             m_objects;
     Components          m_components;
     Properties          m_properties;
-    StringTable         m_strings;
-    StringMap           m_stringMap;
+    mutable StringTable m_strings;
+    mutable StringMap   m_stringMap;
+    mutable std::vector<bool> m_stringDecoded;  // LazyStrings only
+    mutable bool        m_stringMapValid;
+    ByteArray           m_stringBlock;
+    std::vector<size_t> m_stringOffsets;
     std::istream*       m_in;
     char*               m_inRAM;
     size_t              m_inRAMSize;
     size_t              m_inRAMCurrentPos;
+    void*               m_mapping;
+    size_t              m_mappingSize;
+    PositionalFile*     m_positional;
+    BlockReader*        m_blocks;
     void*               m_gzfile;
     int                 m_gzrval;
     std::string         m_inName;
+    uint64              m_inTime;
+    uint64              m_inSize;
     bool                m_needsClosing;
     bool                m_error;
     std::string         m_why;
@@ -508,8 +680,13 @@ private:
     int                 m_charnum;
     ByteArray           m_buffer;
     TypeSpec            m_currentType;
-    size_t              m_currentReadOffset;
-    DataOffsets         m_dataOffsets;
+    uint64              m_currentReadOffset;
+    mutable NameIndex   m_objectIndex;      // name
+    mutable NameIndex   m_componentIndex;   // coffset, name
+    mutable NameIndex   m_propertyIndex;    // poffset, name
+    mutable size_t      m_indexedCount;
+    Arena*              m_arena;
+    size_t              m_requestedBytes;
 };
 
 template <typename T>
@@ -517,9 +694,8 @@ void
 Reader::addToPropertyBuffer(T val)
 {
     size_t i = m_buffer.size();
-    m_buffer.insert(m_buffer.end(), sizeof(T), 0);
-    T* p = reinterpret_cast<T*>(&m_buffer[i]);
-    *p = val;
+    m_buffer.resize(i + sizeof(T));
+    memcpy(&m_buffer[i], &val, sizeof(T));
 }
 
 } // Gto
@@ -0,0 +1,364 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#include "SequenceReader.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#define snprintf _snprintf
+#endif
+
+namespace Gto {
+using namespace std;
+
+//
+//  Frames are Queued until a worker picks them up, Loading while it
+//  reads them and Done (with or without data) after that.
+//
+
+struct SequenceReader::State
+{
+    enum FrameState { Queued, Loading, Done };
+
+    struct Frame
+    {
+        Frame() : state(Queued), data(0) {}
+        FrameState      state;
+        RawDataBase*    data;
+    };
+
+    typedef map<int, Frame> Frames;
+
+    Frames                  frames;
+    deque<int>              queue;
+    vector<thread*>         threads;
+    mutable mutex           lock;
+    condition_variable      wake;
+    condition_variable      done;
+    bool                    stopping;
+
+    State() : stopping(false) {}
+};
+
+SequenceReader::SequenceReader(const string& pattern,
+                               unsigned int readerMode,
+                               int window,
+                               unsigned int threads)
+    : m_pattern(pattern),
+      m_mode(readerMode),
+      m_window(window < 0 ? 0 : window),
+      m_threadCount(threads ? threads : defaultThreadCount()),
+      m_current(0),
+      m_direction(1),
+      m_state(new State)
+{
+}
+
+SequenceReader::~SequenceReader()
+{
+    stop();
+
+    for (State::Frames::iterator i = m_state->frames.begin();
+         i != m_state->frames.end();
+         ++i)
+    {
+        delete i->second.data;
+    }
+
+    delete m_state;
+}
+
+string
+SequenceReader::filename(int frame) const
+{
+    vector<char> buffer(m_pattern.size() + 64);
+    snprintf(&buffer.front(), buffer.size(), m_pattern.c_str(), frame);
+    buffer.back() = 0;
+    return &buffer.front();
+}
+
+RawDataBase*
+SequenceReader::load(const string& filename)
+{
+    RawDataBaseReader reader(m_mode, true);
+    if (!reader.open(filename.c_str())) return 0;
+
+    //
+    //  The reader deletes its database, take the contents instead
+    //
+
+    RawDataBase* db = new RawDataBase;
+    db->objects.swap(reader.dataBase()->objects);
+    db->strings.swap(reader.dataBase()->strings);
+    db->arenas.swap(reader.dataBase()->arenas);
+    return db;
+}
+
+void
+SequenceReader::start()
+{
+    //
+    //  Threads are started on first use rather than in the
+    //  constructor so load() is never called on a partly built object
+    //
+
+    if (!m_state->threads.empty() || m_state->stopping) return;
+
+    unsigned int n = m_threadCount;
+    if (n > unsigned(m_window) + 1) n = m_window + 1;
+
+    for (unsigned int i=0; i < n; i++)
+    {
+        m_state->threads.push_back(new thread(&SequenceReader::worker, this));
+    }
+}
+
+void
+SequenceReader::stop()
+{
+    {
+        lock_guard<mutex> guard(m_state->lock);
+        m_state->stopping = true;
+        m_state->queue.clear();
+    }
+
+    m_state->wake.notify_all();
+
+    for (size_t i=0; i < m_state->threads.size(); i++)
+    {
+        m_state->threads[i]->join();
+        delete m_state->threads[i];
+    }
+
+    m_state->threads.clear();
+
+    //
+    //  Anything left queued will never be read
+    //
+
+    lock_guard<mutex> guard(m_state->lock);
+
+    for (State::Frames::iterator i = m_state->frames.begin();
+         i != m_state->frames.end();)
+    {
+        if (i->second.state != State::Done) m_state->frames.erase(i++);
+        else ++i;
+    }
+
+    m_state->done.notify_all();
+}
+
+void
+SequenceReader::worker()
+{
+    unique_lock<mutex> guard(m_state->lock);
+
+    while (true)
+    {
+        while (m_state->queue.empty() && !m_state->stopping) 
+        {
+            m_state->wake.wait(guard);
+        }
+
+        if (m_state->stopping) return;
+
+        int f = m_state->queue.front();
+        m_state->queue.pop_front();
+        m_state->frames[f].state = State::Loading;
+
+        guard.unlock();
+        RawDataBase* db = load(filename(f));
+        guard.lock();
+
+        //
+        //  The frame may have been dropped while it was being read
+        //
+
+        State::Frames::iterator i = m_state->frames.find(f);
+
+        if (i == m_state->frames.end())
+        {
+            delete db;
+        }
+        else
+        {
+            i->second.state = State::Done;
+            i->second.data  = db;
+        }
+
+        m_state->done.notify_all();
+    }
+}
+
+//
+//  Called with the lock held
+//
+
+void
+SequenceReader::schedule(int frame, bool first)
+{
+    if (m_state->frames.count(frame)) 
+    {
+        if (first && m_state->frames[frame].state == State::Queued)
+        {
+            deque<int>& q = m_state->queue;
+            q.erase(std::find(q.begin(), q.end(), frame));
+            q.push_front(frame);
+        }
+
+        return;
+    }
+
+    m_state->frames[frame] = State::Frame();
+
+    if (first) m_state->queue.push_front(frame);
+    else m_state->queue.push_back(frame);
+}
+
+void
+SequenceReader::evict(int frame)
+{
+    for (State::Frames::iterator i = m_state->frames.begin();
+         i != m_state->frames.end();)
+    {
+        int f = i->first;
+
+        if (f < frame - m_window || f > frame + m_window)
+        {
+            if (i->second.state == State::Queued)
+            {
+                deque<int>& q = m_state->queue;
+                q.erase(std::find(q.begin(), q.end(), f));
+            }
+
+            delete i->second.data;
+            m_state->frames.erase(i++);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void
+SequenceReader::prefetch(int frame)
+{
+    {
+        lock_guard<mutex> guard(m_state->lock);
+        if (m_state->stopping) return;
+        start();
+        schedule(frame, false);
+    }
+
+    m_state->wake.notify_one();
+}
+
+bool
+SequenceReader::isReady(int frame) const
+{
+    lock_guard<mutex> guard(m_state->lock);
+    State::Frames::const_iterator i = m_state->frames.find(frame);
+    return i != m_state->frames.end() && i->second.state == State::Done;
+}
+
+void
+SequenceReader::setWindow(int window)
+{
+    lock_guard<mutex> guard(m_state->lock);
+    m_window = window < 0 ? 0 : window;
+}
+
+const RawDataBase*
+SequenceReader::frame(int frame)
+{
+    unique_lock<mutex> guard(m_state->lock);
+
+    if (frame != m_current) m_direction = frame < m_current ? -1 : 1;
+    m_current = frame;
+
+    evict(frame);
+
+    if (!m_state->stopping)
+    {
+        start();
+        schedule(frame, true);
+
+        for (int i=1; i <= m_window; i++) 
+        {
+            schedule(frame + i * m_direction, false);
+        }
+
+        m_state->wake.notify_all();
+    }
+
+    while (true)
+    {
+        State::Frames::iterator i = m_state->frames.find(frame);
+
+        if (i != m_state->frames.end() && i->second.state == State::Done)
+        {
+            return i->second.data;
+        }
+
+        if (m_state->stopping) break;
+        m_state->done.wait(guard);
+    }
+
+    //
+    //  Stopped: read it on this thread
+    //
+
+    guard.unlock();
+    RawDataBase* db = load(filename(frame));
+    guard.lock();
+
+    State::Frame& f = m_state->frames[frame];
+    delete f.data;
+    f.state = State::Done;
+    f.data  = db;
+    return db;
+}
+
+} // Gto
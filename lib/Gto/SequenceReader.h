@@ -0,0 +1,130 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+#ifndef __Gto__SequenceReader__h__
+#define __Gto__SequenceReader__h__
+
+#include <Gto/config.h>
+#include <Gto/Reader.h>
+#include <Gto/RawData.h>
+#include <string>
+
+namespace Gto {
+
+//
+//  class SequenceReader
+//
+//  Reads a numbered sequence of files (e.g. one cache file per frame)
+//  for playback. The pattern is a printf style format with one integer
+//  conversion, like "name.%04d.gto". When a frame is asked for, the
+//  frames after it (or before it when playing backwards) are read on
+//  background threads so they are usually ready by the time they are
+//  needed. Frames further than the window from the current one are
+//  dropped.
+//
+//  Frames are read into a RawDataBase by default. Override load() to
+//  read them some other way; it's called on the worker threads. A
+//  class that overrides load() must call stop() in its destructor.
+//
+
+class GTO_API SequenceReader
+{
+public:
+    SequenceReader(const std::string& pattern,
+                   unsigned int readerMode = Reader::None,
+                   int window = 4,
+                   unsigned int threads = 0);
+
+    virtual ~SequenceReader();
+
+    std::string         filename(int frame) const;
+
+    //
+    //  Returns the data for the frame, waiting for it if it hasn't
+    //  been read yet, or 0 if it couldn't be read. The SequenceReader
+    //  owns the data; it stays valid until the next call to frame().
+    //
+
+    const RawDataBase*  frame(int frame);
+
+    //
+    //  Non blocking: start reading a frame (if it isn't already) and
+    //  ask if it is done.
+    //
+
+    void                prefetch(int frame);
+    bool                isReady(int frame) const;
+
+    //
+    //  Number of frames read ahead of (and kept behind) the current
+    //  one
+    //
+
+    void                setWindow(int window);
+    int                 window() const { return m_window; }
+
+    //
+    //  Waits for the frames being read and stops the threads. Frames
+    //  already read are kept.
+    //
+
+    void                stop();
+
+protected:
+    virtual RawDataBase* load(const std::string& filename);
+
+private:
+    SequenceReader(const SequenceReader&);
+    SequenceReader& operator=(const SequenceReader&);
+
+    void                schedule(int frame, bool first);
+    void                evict(int frame);
+    void                start();
+    void                worker();
+
+    struct State;
+
+    std::string         m_pattern;
+    unsigned int        m_mode;
+    int                 m_window;
+    unsigned int        m_threadCount;
+    int                 m_current;
+    int                 m_direction;
+    State*              m_state;
+};
+
+} // Gto
+
+#endif // __Gto__SequenceReader__h__
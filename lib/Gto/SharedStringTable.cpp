@@ -0,0 +1,99 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#include "SharedStringTable.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace Gto {
+using namespace std;
+
+SharedStringTable::SharedStringTable() : m_finished(false)
+{
+}
+
+SharedStringTable::~SharedStringTable()
+{
+}
+
+void
+SharedStringTable::intern(const char* s)
+{
+    intern(string(s));
+}
+
+void
+SharedStringTable::intern(const string& s)
+{
+    if (m_finished)
+    {
+        throw std::runtime_error("Gto::SharedStringTable::intern(): Unable "
+                                 "to intern strings after finish()");
+    }
+
+    m_strings.push_back(s);
+}
+
+void
+SharedStringTable::finish()
+{
+    if (m_finished) return;
+
+    //
+    //  Same order the Writer gives its own strings
+    //
+
+    sort(m_strings.begin(), m_strings.end());
+    m_strings.erase(unique(m_strings.begin(), m_strings.end()), m_strings.end());
+
+    m_ids.reserve(m_strings.size());
+
+    for (size_t i=0; i < m_strings.size(); i++)
+    {
+        m_ids[m_strings[i]] = int(i);
+    }
+
+    m_finished = true;
+}
+
+int
+SharedStringTable::lookup(const string& s) const
+{
+    StringMap::const_iterator i = m_ids.find(s);
+    return i == m_ids.end() ? -1 : i->second;
+}
+
+} // Gto
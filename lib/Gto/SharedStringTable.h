@@ -0,0 +1,94 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+#ifndef __Gto__SharedStringTable__h__
+#define __Gto__SharedStringTable__h__
+
+#include <Gto/config.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Gto {
+
+//
+//  class Gto::SharedStringTable
+//
+//  A string table built once and used by many Writers (see
+//  Writer::setSharedStringTable()), typically the names every frame
+//  of a sequence has in common. Its strings get the first ids in
+//  each file, in sorted order; whatever else a file interns is
+//  numbered after them. Once finish() has been called the table is
+//  read only and any number of Writers on any threads can use it.
+//  It must outlive them.
+//
+
+class GTO_API SharedStringTable
+{
+public:
+    typedef std::vector<std::string>                Strings;
+    typedef std::unordered_map<std::string, int>    StringMap;
+
+    SharedStringTable();
+    ~SharedStringTable();
+
+    //
+    //  Adding strings after finish() throws std::runtime_error
+    //
+
+    void            intern(const char*);
+    void            intern(const std::string&);
+
+    void            finish();
+    bool            isFinished() const { return m_finished; }
+
+    //
+    //  The id a string gets in files using the table or -1
+    //
+
+    int             lookup(const std::string&) const;
+
+    size_t          size() const { return m_strings.size(); }
+    const Strings&  strings() const { return m_strings; }
+
+private:
+    Strings         m_strings;
+    StringMap       m_ids;
+    bool            m_finished;
+};
+
+} // Gto
+
+#endif // __Gto__SharedStringTable__h__
@@ -0,0 +1,1358 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#include "TextParser.h"
+#include "Reader.h"
+#include "Utilities.h"
+#include "Parallel.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef GTO_SUPPORT_HALF
+#include <half.h>
+#endif
+
+namespace Gto {
+
+namespace {
+
+inline bool isDigit(char c)  { return c >= '0' && c <= '9'; }
+inline bool isAlpha(char c)  { return (c >= 'a' && c <= 'z') ||
+                                      (c >= 'A' && c <= 'Z') || c == '_'; }
+inline bool isAlnum(char c)  { return isAlpha(c) || isDigit(c); }
+
+inline int
+hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+//
+//  Powers of ten which are exact doubles. A decimal with at most 15
+//  significant digits and an exponent in this range converts with a
+//  single correctly rounded multiply or divide; everything else goes
+//  to strtod().
+//
+
+const double exactPowers[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+    1e22
+};
+
+double
+slowFloat(const char* begin, const char* end)
+{
+    std::string s(begin, end);
+    return strtod(s.c_str(), 0);
+}
+
+double
+parseFloat(const char* begin, const char* end)
+{
+    const char* p = begin;
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+
+    for (; p != end && isDigit(*p); ++p)
+    {
+        if (digits || *p != '0') digits++;
+        if (digits > 15) return slowFloat(begin, end);
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+
+    if (p != end && *p == '.')
+    {
+        for (++p; p != end && isDigit(*p); ++p)
+        {
+            if (digits || *p != '0') digits++;
+            if (digits > 15) return slowFloat(begin, end);
+            mantissa = mantissa * 10 + (*p - '0');
+            exponent--;
+        }
+    }
+
+    if (p != end)
+    {
+        //
+        //  Exponent; the lexer guarantees [Ee][+-]?[0-9]+
+        //
+
+        bool negative = false;
+        int e = 0;
+        ++p;
+
+        if (*p == '+' || *p == '-') negative = *p++ == '-';
+
+        for (; p != end; ++p)
+        {
+            if (e < 10000) e = e * 10 + (*p - '0');
+        }
+
+        exponent += negative ? -e : e;
+    }
+
+    if (mantissa == 0) return 0.0;
+    if (exponent < -22 || exponent > 22) return slowFloat(begin, end);
+
+    return exponent < 0 ? double(mantissa) / exactPowers[-exponent]
+                        : double(mantissa) * exactPowers[exponent];
+}
+
+//
+//  Same result as strtol(s, 0, 0) assigned to an int: decimal, 0x hex
+//  or leading-zero octal.
+//
+
+int
+parseInt(const char* begin, const char* end)
+{
+    const char* p = begin;
+    unsigned int base = 10;
+
+    if (end - p > 2 && p[1] == 'x') { base = 16; p += 2; }
+    else if (end - p > 1 && *p == '0') { base = 8; p++; }
+
+    if (end - p > 15)
+    {
+        std::string s(begin, end);
+        return int(strtol(s.c_str(), 0, 0));
+    }
+
+    long long value = 0;
+
+    for (; p != end; ++p)
+    {
+        int d = hexValue(*p);
+        if (d < 0 || d >= int(base)) break;
+        value = value * base + d;
+    }
+
+    return int(value);
+}
+
+struct Keyword
+{
+    const char* name;
+    size_t      length;
+    int         token;
+};
+
+//
+//  Numeric property bodies with less text than this are converted on
+//  the first pass even in parallel mode
+//
+
+const size_t MinParallelBody = 1 << 16;
+
+} // anonymous namespace
+
+TextParser::TextParser(Reader* reader, 
+                       const char* begin, 
+                       const char* end,
+                       bool parallel)
+    : m_reader(reader),
+      m_p(begin),
+      m_end(end),
+      m_lineStart(begin),
+      m_line(1),
+      m_tokenStart(begin),
+      m_token(End),
+      m_int(0),
+      m_float(0),
+      m_type(Int),
+      m_buffer(&reader->m_buffer),
+      m_parallel(parallel),
+      m_detached(false)
+{
+}
+
+//----------------------------------------------------------------------
+//
+//  Lexer
+//
+
+void
+TextParser::next()
+{
+    for (;;)
+    {
+        while (m_p != m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\r'))
+        {
+            ++m_p;
+        }
+
+        m_tokenStart = m_p;
+        updatePosition();
+
+        if (m_p == m_end)
+        {
+            m_token = End;
+            return;
+        }
+
+        char c = *m_p;
+
+        if (c == '\n')
+        {
+            m_lineStart = ++m_p;
+            m_line++;
+        }
+        else if (c == '#')
+        {
+            while (m_p != m_end && *m_p != '\n') ++m_p;
+        }
+        else if (c == '{' && m_end - m_p >= 11 &&
+                 !memcmp(m_p, "{%%debug%%}", 11))
+        {
+            m_p += 11;
+        }
+        else if (isDigit(c) || (c == '.' && m_p + 1 != m_end))
+        {
+            lexNumber();
+            return;
+        }
+        else if (isAlpha(c))
+        {
+            lexIdentifier();
+            return;
+        }
+        else if (c == '"')
+        {
+            lexString();
+            return;
+        }
+        else if (c == '\'')
+        {
+            lexCharacter();
+            return;
+        }
+        else
+        {
+            m_token = (unsigned char)c;
+            ++m_p;
+            return;
+        }
+    }
+}
+
+void
+TextParser::lexNumber()
+{
+    //
+    //  Longest match among integer, hex, float, identifier (digits
+    //  followed by letters) and "...". Ties go to the earlier one in
+    //  that list.
+    //
+
+    const char* s = m_p;
+    const char* d = s;
+    while (d != m_end && isDigit(*d)) ++d;
+
+    const char* intEnd = d == s ? 0 : d;
+    const char* hexEnd = 0;
+    const char* floatEnd = 0;
+    const char* identEnd = 0;
+    const char* ellipsisEnd = 0;
+
+    if (d - s == 1 && *s == '0' && m_end - d > 1 && d[0] == 'x' &&
+        hexValue(d[1]) >= 0)
+    {
+        hexEnd = d + 1;
+        while (hexEnd != m_end && hexValue(*hexEnd) >= 0) ++hexEnd;
+    }
+
+    const char* f = d;
+    bool isFloat = false;
+
+    if (f != m_end && *f == '.')
+    {
+        const char* frac = f + 1;
+        while (frac != m_end && isDigit(*frac)) ++frac;
+
+        if (frac - f > 1)       { f = frac; isFloat = true; }
+        else if (d != s)        { f = f + 1; isFloat = true; }
+    }
+
+    if ((isFloat || d != s) && f != m_end && (*f == 'e' || *f == 'E'))
+    {
+        const char* e = f + 1;
+        if (e != m_end && (*e == '+' || *e == '-')) ++e;
+
+        if (e != m_end && isDigit(*e))
+        {
+            while (e != m_end && isDigit(*e)) ++e;
+            f = e;
+            isFloat = true;
+        }
+    }
+
+    if (isFloat) floatEnd = f;
+
+    if (d != s && d != m_end && isAlpha(*d))
+    {
+        identEnd = d + 1;
+        while (identEnd != m_end && isAlnum(*identEnd)) ++identEnd;
+    }
+
+    if (d == s && m_end - s >= 3 && s[1] == '.' && s[2] == '.')
+    {
+        ellipsisEnd = s + 3;
+    }
+
+    const char* best = 0;
+    int token = 0;
+
+    if (ellipsisEnd)                          { best = ellipsisEnd; token = Ellipsis; }
+    if (intEnd && intEnd > best)              { best = intEnd; token = IntConst; }
+    if (hexEnd && hexEnd > best)              { best = hexEnd; token = IntConst; }
+    if (floatEnd && floatEnd > best)          { best = floatEnd; token = FloatConst; }
+    if (identEnd && identEnd > best)          { best = identEnd; token = StringConst; }
+
+    if (!best)
+    {
+        m_token = (unsigned char)*m_p++;
+        return;
+    }
+
+    m_p = best;
+    m_token = token;
+
+    switch (token)
+    {
+      case IntConst:
+          m_int = parseInt(s, best);
+          break;
+      case FloatConst:
+          m_float = parseFloat(s, best);
+          break;
+      case StringConst:
+          if (m_detached)
+          {
+              m_string.assign(s, best);
+              m_int = -1;
+          }
+          else
+          {
+              m_int = m_reader->internString(std::string(s, best));
+          }
+          break;
+    }
+}
+
+void
+TextParser::lexIdentifier()
+{
+    static const Keyword keywords[] =
+    {
+        { "GTOa",   4, GtoId },
+        { "as",     2, As },
+        { "float",  5, FloatType },
+        { "double", 6, DoubleType },
+        { "int",    3, IntType },
+        { "bool",   4, BoolType },
+        { "half",   4, HalfType },
+        { "byte",   4, ByteType },
+        { "short",  5, ShortType },
+        { "string", 6, StringType },
+        { 0, 0, 0 }
+    };
+
+    const char* s = m_p;
+    while (m_p != m_end && isAlnum(*m_p)) ++m_p;
+    size_t length = m_p - s;
+
+    for (const Keyword* k = keywords; k->name; ++k)
+    {
+        if (k->length == length && !memcmp(k->name, s, length))
+        {
+            m_token = k->token;
+            return;
+        }
+    }
+
+    m_token = StringConst;
+
+    if (m_detached)
+    {
+        m_string.assign(s, m_p);
+        m_int = -1;
+    }
+    else
+    {
+        m_int = m_reader->internString(std::string(s, m_p));
+    }
+}
+
+void
+TextParser::lexString()
+{
+    const char* s = ++m_p;
+
+    //
+    //  Strings without escapes or line breaks are interned straight
+    //  from the buffer
+    //
+
+    while (m_p != m_end && *m_p != '"' && *m_p != '\\' &&
+           *m_p != '\n' && *m_p != '\r')
+    {
+        ++m_p;
+    }
+
+    if (m_p != m_end && *m_p == '"')
+    {
+        m_int = m_reader->internString(std::string(s, m_p++));
+        m_token = StringConst;
+        return;
+    }
+
+    m_string.assign(s, m_p);
+
+    while (m_p != m_end && *m_p != '"')
+    {
+        char c = *m_p;
+
+        if (c == '\r' && m_end - m_p > 1 && m_p[1] == '\n')
+        {
+            ++m_p;
+            continue;
+        }
+
+        if (c == '\n')
+        {
+            m_string.push_back('\n');
+            m_lineStart = ++m_p;
+            m_line++;
+            continue;
+        }
+
+        if (c != '\\' || m_end - m_p < 2)
+        {
+            m_string.push_back(c);
+            ++m_p;
+            continue;
+        }
+
+        char e = m_p[1];
+
+        if (e == 'u')
+        {
+            const char* h = m_p + 2;
+            unsigned int u = 0;
+            while (h != m_end && hexValue(*h) >= 0) u = u * 16 + hexValue(*h++);
+
+            if (h - m_p - 2 >= 4)
+            {
+                m_string.push_back(char(u));
+                m_p = h;
+                continue;
+            }
+        }
+        else if (e >= '0' && e <= '3')
+        {
+            if (m_end - m_p >= 4 &&
+                m_p[2] >= '0' && m_p[2] <= '7' &&
+                m_p[3] >= '0' && m_p[3] <= '7')
+            {
+                m_string.push_back(char((e - '0') * 64 +
+                                        (m_p[2] - '0') * 8 +
+                                        (m_p[3] - '0')));
+                m_p += 4;
+                continue;
+            }
+        }
+        else
+        {
+            char r = 0;
+
+            switch (e)
+            {
+              case 'b':  r = '\b'; break;
+              case 't':  r = '\t'; break;
+              case 'n':  r = '\n'; break;
+              case 'f':  r = '\f'; break;
+              case 'r':  r = '\r'; break;
+              case '"':  r = '"';  break;
+              case '\\': r = '\\'; break;
+            }
+
+            if (r)
+            {
+                m_string.push_back(r);
+                m_p += 2;
+                continue;
+            }
+        }
+
+        m_string.push_back(c);
+        ++m_p;
+    }
+
+    if (m_p == m_end)
+    {
+        error("unterminated string");
+        m_token = Error;
+        return;
+    }
+
+    ++m_p;
+    m_int = m_reader->internString(m_string);
+    m_token = StringConst;
+}
+
+void
+TextParser::lexCharacter()
+{
+    //
+    //  Character constants are integers: 'c', '\n' style escapes and
+    //  '\uXXXX'
+    //
+
+    const char* s = m_p;
+    size_t n = m_end - s;
+
+    if (n >= 8 && s[1] == '\\' && s[2] == 'u')
+    {
+        const char* h = s + 3;
+        unsigned int u = 0;
+        while (h != m_end && hexValue(*h) >= 0) u = u * 16 + hexValue(*h++);
+
+        if (h - s - 3 >= 4 && h != m_end && *h == '\'')
+        {
+            m_p = h + 1;
+            m_int = int(u);
+            m_token = IntConst;
+            return;
+        }
+    }
+
+    if (n >= 4 && s[1] == '\\' && s[3] == '\'')
+    {
+        int value = -1;
+
+        switch (s[2])
+        {
+          case 'b':  value = '\b'; break;
+          case 't':  value = '\t'; break;
+          case 'n':  value = '\n'; break;
+          case 'f':  value = '\f'; break;
+          case 'r':  value = '\r'; break;
+          case '\\': value = '\\'; break;
+        }
+
+        if (value >= 0)
+        {
+            m_p += 4;
+            m_int = value;
+            m_token = IntConst;
+            return;
+        }
+    }
+
+    if (n >= 3 && s[1] != '\n' && s[2] == '\'')
+    {
+        m_p += 3;
+        m_int = int(s[1]);
+        m_token = IntConst;
+        return;
+    }
+
+    m_token = (unsigned char)*m_p++;
+}
+
+//----------------------------------------------------------------------
+//
+//  Parser
+//
+
+bool
+TextParser::parse()
+{
+    next();
+
+    if (m_token != GtoId) return syntaxError();
+    next();
+
+    uint32 version = GTO_VERSION;
+
+    if (m_token == '(')
+    {
+        next();
+        if (m_token != IntConst) return syntaxError();
+        version = m_int;
+        next();
+        if (!expect(')')) return false;
+    }
+
+    m_reader->beginHeader(version);
+
+    if (m_token != StringConst) return syntaxError();
+
+    while (m_token == StringConst)
+    {
+        if (!parseObject()) return false;
+    }
+
+    if (m_token != End) return syntaxError();
+    if (m_parallel && !finishDeferred()) return false;
+
+    m_reader->endFile();
+    return true;
+}
+
+bool
+TextParser::parseObject()
+{
+    unsigned int name = m_int;
+    next();
+
+    if (m_token == ':')
+    {
+        next();
+        if (m_token != StringConst) return syntaxError();
+        unsigned int protocol = m_int;
+        unsigned int version  = 1;
+        next();
+
+        if (m_token == '(')
+        {
+            next();
+            if (m_token != IntConst) return syntaxError();
+            version = m_int;
+            next();
+            if (!expect(')')) return false;
+        }
+
+        if (m_token != '{') return syntaxError();
+        m_reader->beginObject(name, protocol, version);
+    }
+    else if (m_token == '{')
+    {
+        m_reader->beginObject(name, m_reader->internString("object"));
+    }
+    else
+    {
+        return syntaxError();
+    }
+
+    next();
+
+    if (m_token != StringConst) return syntaxError();
+
+    while (m_token == StringConst)
+    {
+        if (!parseComponent()) return false;
+    }
+
+    return expect('}');
+}
+
+bool
+TextParser::parseInterp(unsigned int& interp)
+{
+    if (m_token == As)
+    {
+        next();
+        if (m_token != StringConst) return syntaxError();
+        interp = m_int;
+        next();
+    }
+    else
+    {
+        interp = m_reader->internString("");
+    }
+
+    return true;
+}
+
+bool
+TextParser::parseComponent()
+{
+    unsigned int name = m_int;
+    unsigned int interp;
+    next();
+
+    if (!parseInterp(interp)) return false;
+    if (m_token != '{') return syntaxError();
+    m_reader->beginComponent(name, interp);
+    next();
+
+    if (m_token < FloatType || m_token > StringType) return syntaxError();
+
+    while (m_token >= FloatType && m_token <= StringType)
+    {
+        if (!parseProperty()) return false;
+    }
+
+    return expect('}');
+}
+
+bool
+TextParser::parseProperty()
+{
+    DataType type;
+
+    switch (m_token)
+    {
+      case FloatType:   type = Float; break;
+      case DoubleType:  type = Double; break;
+      case IntType:     type = Int; break;
+      case BoolType:    type = Boolean; break;
+      case HalfType:    type = Half; break;
+      case ByteType:    type = Byte; break;
+      case ShortType:   type = Short; break;
+      default:          type = String; break;
+    }
+
+    unsigned int width = 1;
+    unsigned int size  = 0;
+    next();
+
+    if (m_token == '[')
+    {
+        next();
+        if (m_token != IntConst) return syntaxError();
+        width = m_int;
+        next();
+        if (!expect(']')) return false;
+
+        if (m_token == '[')
+        {
+            next();
+            if (m_token != IntConst) return syntaxError();
+            size = m_int;
+            next();
+            if (!expect(']')) return false;
+        }
+    }
+
+    if (m_token != StringConst) return syntaxError();
+    unsigned int name = m_int;
+    unsigned int interp;
+    next();
+
+    if (!parseInterp(interp)) return false;
+    if (m_token != '=') return syntaxError();
+
+    m_reader->beginProperty(name, interp, width, size, type);
+    m_type = type;
+    next();
+
+    if (m_token != '[')
+    {
+        if (!parseValue()) return false;
+
+        if (width != 1)
+        {
+            error("expected data width of %d, found 1", width);
+            return false;
+        }
+        else if (size != 0 && numValues() != size)
+        {
+            error("property size mismatch, found %d, expect %d",
+                  int(numValues()), size);
+            return false;
+        }
+
+        endProperty();
+        return true;
+    }
+
+    if (m_parallel && type != String && type != Boolean)
+    {
+        int lines = 0;
+        const char* lineStart = m_lineStart;
+        const char* close = scanBody(lines, lineStart);
+
+        if (close && size_t(close - m_p) >= MinParallelBody)
+        {
+            m_deferred.push_back(Deferred());
+            Deferred& d = m_deferred.back();
+            d.property  = m_reader->m_properties.size() - 1;
+            d.begin     = m_p;
+            d.end       = close + 1;
+            d.lineStart = m_lineStart;
+            d.line      = m_line;
+            d.width     = width;
+            d.size      = size;
+            d.type      = type;
+
+            ByteArray().swap(*m_buffer);
+            m_p         = close + 1;
+            m_line     += lines;
+            m_lineStart = lineStart;
+            next();
+            return true;
+        }
+    }
+
+    next();
+    if (!parseBody(width, size)) return false;
+    endProperty();
+    next();
+    return true;
+}
+
+bool
+TextParser::parseBody(unsigned int width, unsigned int size)
+{
+    //
+    //  The elements of a bracketed property value up to (but not
+    //  past) the closing bracket
+    //
+
+    bool ellipsis = false;
+
+    for (size_t n = 0; m_token != ']'; n++)
+    {
+        if (m_token == Ellipsis && n)
+        {
+            ellipsis = true;
+            next();
+            break;
+        }
+        else if (m_token == '[')
+        {
+            next();
+            size_t count = 0;
+
+            for (; m_token != ']'; count++)
+            {
+                if (!parseValue()) return false;
+            }
+
+            if (!count) return syntaxError();
+
+            if (count != width)
+            {
+                error("expected data width of %d, found %d",
+                      width, int(count));
+                return false;
+            }
+
+            next();
+        }
+        else if (!parseValue())
+        {
+            return false;
+        }
+    }
+
+    if (m_token != ']') return syntaxError();
+
+    size_t nelements = numElements(width);
+
+    if (size != 0 && nelements != size)
+    {
+        if (!ellipsis || nelements == 0 || nelements > size)
+        {
+            error("property size mismatch, found %d, expect %d",
+                  int(nelements), size);
+            return false;
+        }
+
+        //
+        //  Repeat the last element
+        //
+
+        size_t elementSize = dataSize(m_type) * width;
+        size_t last = nelements * elementSize - elementSize;
+        m_buffer->resize(size_t(size) * elementSize);
+
+        for (size_t i = last + elementSize; i < m_buffer->size(); i += elementSize)
+        {
+            memcpy(&(*m_buffer)[i], &(*m_buffer)[last], elementSize);
+        }
+    }
+    else if (size == 0 && ellipsis)
+    {
+        error("use of ... requires fixed property size but none "
+              "was provided");
+        return false;
+    }
+
+    return true;
+}
+
+void
+TextParser::endProperty()
+{
+    if (m_parallel)
+    {
+        //
+        //  Keep the data in order with the deferred bodies
+        //
+
+        m_deferred.push_back(Deferred());
+        Deferred& d = m_deferred.back();
+        d.property  = m_reader->m_properties.size() - 1;
+        d.data.swap(*m_buffer);
+    }
+    else
+    {
+        m_reader->endProperty();
+    }
+}
+
+template <typename T>
+inline void
+TextParser::append(T value)
+{
+    size_t i = m_buffer->size();
+    m_buffer->resize(i + sizeof(T));
+    memcpy(&(*m_buffer)[i], &value, sizeof(T));
+}
+
+size_t
+TextParser::numValues() const
+{
+    return m_buffer->size() / dataSize(m_type);
+}
+
+size_t
+TextParser::numElements(unsigned int width) const
+{
+    return width ? numValues() / width : 0;
+}
+
+//----------------------------------------------------------------------
+//
+//  Parallel parsing
+//
+
+const char*
+TextParser::scanBody(int& lines, const char*& lineStart) const
+{
+    //
+    //  Finds the bracket closing the body that starts at m_p. Returns
+    //  0 if the body has anything but numbers in it (character
+    //  constants, hex, strings) so it can be parsed normally.
+    //
+
+    int depth = 1;
+
+    for (const char* p = m_p; p != m_end; ++p)
+    {
+        switch (*p)
+        {
+          case '0': case '1': case '2': case '3': case '4':
+          case '5': case '6': case '7': case '8': case '9':
+          case ' ': case '\t': case '\r': case '.': case '-':
+          case '+': case 'e': case 'E':
+              break;
+
+          case '\n':
+              lines++;
+              lineStart = p + 1;
+              break;
+
+          case '#':
+              while (p + 1 != m_end && p[1] != '\n') ++p;
+              break;
+
+          case '[':
+              depth++;
+              break;
+
+          case ']':
+              if (--depth == 0) return p;
+              break;
+
+          default:
+              return 0;
+        }
+    }
+
+    return 0;
+}
+
+void
+TextParser::parseDeferred(Deferred& d)
+{
+    //
+    //  Runs on a worker thread. Nothing here may touch the Reader:
+    //  the body is converted into d.data and messages are kept for
+    //  finishDeferred().
+    //
+
+    TextParser parser(m_reader, d.begin, d.end);
+    parser.m_detached  = true;
+    parser.m_buffer    = &d.data;
+    parser.m_type      = d.type;
+    parser.m_line      = d.line;
+    parser.m_lineStart = d.lineStart;
+
+    if (d.size) d.data.reserve(size_t(d.size) * d.width * dataSize(d.type));
+
+    parser.next();
+    d.ok = parser.parseBody(d.width, d.size);
+    d.messages.swap(parser.m_messages);
+}
+
+bool
+TextParser::finishDeferred()
+{
+    std::vector<Deferred*> bodies;
+
+    for (size_t i = 0; i < m_deferred.size(); i++)
+    {
+        if (m_deferred[i].begin) bodies.push_back(&m_deferred[i]);
+    }
+
+    struct ParseBody
+    {
+        TextParser* parser;
+        std::vector<Deferred*>* bodies;
+        void operator() (size_t i) { parser->parseDeferred(*(*bodies)[i]); }
+    };
+
+    ParseBody f = { this, &bodies };
+    parallelFor(bodies.size(), defaultThreadCount(), f);
+
+    //
+    //  Report and deliver in file order, stopping at the first error
+    //  as the sequential parser would
+    //
+
+    for (size_t i = 0; i < m_deferred.size(); i++)
+    {
+        Deferred& d = m_deferred[i];
+
+        for (size_t q = 0; q < d.messages.size(); q++)
+        {
+            const Message& m = d.messages[q];
+            m_reader->m_linenum = m.line;
+            m_reader->m_charnum = m.charnum;
+
+            if (m.error) m_reader->parseError(m.text.c_str());
+            else m_reader->parseWarning(m.text.c_str());
+        }
+
+        if (!d.ok) return false;
+
+        m_reader->textPropertyData(m_reader->m_properties[d.property], d.data);
+        ByteArray().swap(d.data);
+    }
+
+    return true;
+}
+
+bool
+TextParser::parseValue()
+{
+    bool ok;
+
+    switch (m_token)
+    {
+      case IntConst:
+          ok = addInt(m_int);
+          break;
+
+      case FloatConst:
+          ok = addFloat(m_float);
+          break;
+
+      case StringConst:
+          if (m_type != String)
+          {
+              error("expected a numeric value, found string \"%s\"",
+                    m_int < 0 ? m_string.c_str() 
+                              : m_reader->stringFromId(m_int).c_str());
+              return false;
+          }
+
+          append(m_int);
+          ok = true;
+          break;
+
+      case '-':
+          next();
+          if (m_token == IntConst) ok = addInt(int(0u - unsigned(m_int)));
+          else if (m_token == FloatConst) ok = addFloat(-m_float);
+          else return syntaxError();
+          break;
+
+      default:
+          return syntaxError();
+    }
+
+    if (ok) next();
+    return ok;
+}
+
+bool
+TextParser::addInt(int v)
+{
+    switch (m_type)
+    {
+      case Int:
+          append(v);
+          return true;
+
+      case Float:
+          if (v != float(v))
+          {
+              warning("integer cannot be represented "
+                      "as floating point (%d => %f)", v, float(v));
+          }
+
+          append(float(v));
+          return true;
+
+      case Double:
+          append(double(v));
+          return true;
+
+#ifdef GTO_SUPPORT_HALF
+      case Half:
+          if (v != half(v))
+          {
+              warning("integer cannot be represented "
+                      "as half (%d => %f)", v, float(v));
+          }
+
+          append(half(v));
+          return true;
+#endif
+
+      case Short:
+          if (v != short(v))
+          {
+              warning("integer cannot be represented "
+                      "as short (%d => %d)", v, short(v));
+          }
+
+          append(short(v));
+          return true;
+
+      case Byte:
+          if (v != (unsigned char)(v))
+          {
+              warning("integer cannot be represented "
+                      "as byte (%d => %d)", v, (unsigned char)(v));
+          }
+
+          append((unsigned char)(v));
+          return true;
+
+      case String:
+          error("string expected; got an integer (%d) instead", v);
+          return false;
+
+      case Boolean:
+          error("numeric type '%s' is currently unsupported "
+                "by the parser", typeName(m_type));
+          return false;
+
+      default:
+          error("unsupported type '%s'; got an integer (%d) instead",
+                typeName(m_type), v);
+          return false;
+    }
+}
+
+bool
+TextParser::addFloat(double v)
+{
+    switch (m_type)
+    {
+      case Float:
+          append(float(v));
+          return true;
+
+      case Double:
+          append(v);
+          return true;
+
+      case Int:
+          if (v != int(v))
+          {
+              warning("floating point value truncated "
+                      "to match integer property type (%f => %d)",
+                      v, int(v));
+          }
+
+          append(int(v));
+          return true;
+
+#ifdef GTO_SUPPORT_HALF
+      case Half:
+          append(half(v));
+          return true;
+#else
+      case Half:
+          error("numeric type '%s' is currently unsupported "
+                "by the parser", typeName(m_type));
+          return false;
+#endif
+
+      case Short:
+          if (v != short(v))
+          {
+              warning("floating point value truncated "
+                      "to match short property type (%f => %d)",
+                      v, int(short(v)));
+          }
+
+          append(short(v));
+          return true;
+
+      case Byte:
+          if (v != (unsigned char)(v))
+          {
+              warning("floating point value truncated "
+                      "to match byte property type (%f => %d)",
+                      v, int((unsigned char)(v)));
+          }
+
+          append((unsigned char)(v));
+          return true;
+
+      case String:
+          error("string expected; got a floating "
+                "point number (%f) instead", v);
+          return false;
+
+      default:
+          error("unsupported type '%s'; got a floating "
+                "point number (%f) instead", typeName(m_type), v);
+          return false;
+    }
+}
+
+//----------------------------------------------------------------------
+//
+//  Errors
+//
+
+bool
+TextParser::expect(int token)
+{
+    if (m_token != token) return syntaxError();
+    next();
+    return true;
+}
+
+bool
+TextParser::syntaxError()
+{
+    //
+    //  Lexer errors have already been reported
+    //
+
+    if (m_token == Error) return false;
+
+    if (m_token == End)
+    {
+        error("syntax error, unexpected end of file");
+    }
+    else
+    {
+        size_t n = m_p - m_tokenStart;
+        if (n > 32) n = 32;
+        std::string text(m_tokenStart, n);
+        error("syntax error, unexpected \"%s\"", text.c_str());
+    }
+
+    return false;
+}
+
+void
+TextParser::updatePosition()
+{
+    if (m_detached) return;
+    m_reader->m_linenum = m_line;
+    m_reader->m_charnum = int(m_tokenStart - m_lineStart) + 1;
+}
+
+void
+TextParser::error(const char* fmt, ...)
+{
+    char temp[256];
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(temp, sizeof(temp), fmt, ap);
+    va_end(ap);
+
+    if (m_detached)
+    {
+        Message m;
+        m.error   = true;
+        m.line    = m_line;
+        m.charnum = int(m_tokenStart - m_lineStart) + 1;
+        m.text    = temp;
+        m_messages.push_back(m);
+        return;
+    }
+
+    updatePosition();
+    m_reader->parseError(temp);
+}
+
+void
+TextParser::warning(const char* fmt, ...)
+{
+    char temp[256];
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(temp, sizeof(temp), fmt, ap);
+    va_end(ap);
+
+    if (m_detached)
+    {
+        Message m;
+        m.error   = false;
+        m.line    = m_line;
+        m.charnum = int(m_tokenStart - m_lineStart) + 1;
+        m.text    = temp;
+        m_messages.push_back(m);
+        return;
+    }
+
+    updatePosition();
+    m_reader->parseWarning(temp);
+}
+
+} // Gto
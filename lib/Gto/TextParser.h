@@ -0,0 +1,190 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+#ifndef __Gto__TextParser__h__
+#define __Gto__TextParser__h__
+
+#include <Gto/Header.h>
+#include <string>
+#include <vector>
+
+namespace Gto {
+
+class Reader;
+
+//
+//  class TextParser
+//
+//  Recursive descent parser for the text (GTOa) format. It scans a
+//  buffer holding the whole file and drives the Reader's text parser
+//  entry points (beginHeader(), beginObject(), ...). Tokens are not
+//  copied: numbers are converted straight out of the buffer and only
+//  strings with escapes are assembled on the side.
+//
+//  parse() returns false after reporting the first error through
+//  Reader::parseError(). Warnings go to Reader::parseWarning().
+//
+//  If parallel is true, the bodies of large numeric properties are
+//  only scanned for their closing bracket on the first pass and are
+//  converted on several threads once the whole file has been seen.
+//  The data is then handed to the Reader in property order.
+//
+
+class TextParser
+{
+public:
+    TextParser(Reader* reader, 
+               const char* begin, 
+               const char* end,
+               bool parallel = false);
+
+    bool                parse();
+
+private:
+    typedef std::vector<unsigned char> ByteArray;
+
+    struct Message
+    {
+        bool            error;
+        int             line;
+        int             charnum;
+        std::string     text;
+    };
+
+    typedef std::vector<Message> Messages;
+
+    //
+    //  Property data held back until the end of a parallel parse.
+    //  Bodies with begin set are converted by a detached parser.
+    //
+
+    struct Deferred
+    {
+        Deferred() : property(0), begin(0), end(0), lineStart(0), 
+                     line(0), width(0), size(0), type(Int), ok(true) {}
+
+        size_t          property;
+        ByteArray       data;
+        const char*     begin;
+        const char*     end;
+        const char*     lineStart;
+        int             line;
+        unsigned int    width;
+        unsigned int    size;
+        DataType        type;
+        bool            ok;
+        Messages        messages;
+    };
+
+    typedef std::vector<Deferred> DeferredVector;
+
+    void                parseDeferred(Deferred&);
+    bool                finishDeferred();
+    const char*         scanBody(int& lines, const char*& lineStart) const;
+
+    enum Token
+    {
+        End = 0,
+
+        //
+        //  Single character tokens are their own character code
+        //
+
+        Error = 256,
+        GtoId,
+        As,
+        Ellipsis,
+        StringConst,
+        IntConst,
+        FloatConst,
+        FloatType,
+        DoubleType,
+        IntType,
+        BoolType,
+        HalfType,
+        ByteType,
+        ShortType,
+        StringType
+    };
+
+    void                next();
+    void                lexNumber();
+    void                lexCharacter();
+    void                lexString();
+    void                lexIdentifier();
+
+    bool                parseObject();
+    bool                parseComponent();
+    bool                parseProperty();
+    bool                parseInterp(unsigned int&);
+    bool                parseBody(unsigned int width, unsigned int size);
+    bool                parseValue();
+    bool                addInt(int);
+    bool                addFloat(double);
+    void                endProperty();
+
+    template <typename T>
+    void                append(T);
+
+    size_t              numValues() const;
+    size_t              numElements(unsigned int width) const;
+
+    bool                expect(int token);
+    bool                syntaxError();
+    void                error(const char* fmt, ...);
+    void                warning(const char* fmt, ...);
+    void                updatePosition();
+
+private:
+    Reader*             m_reader;
+    const char*         m_p;
+    const char*         m_end;
+    const char*         m_lineStart;
+    int                 m_line;
+    const char*         m_tokenStart;
+    int                 m_token;
+    int                 m_int;
+    double              m_float;
+    DataType            m_type;
+    std::string         m_string;
+    ByteArray*          m_buffer;
+    bool                m_parallel;
+    bool                m_detached;
+    Messages            m_messages;
+    DeferredVector      m_deferred;
+};
+
+} // Gto
+
+#endif // __Gto__TextParser__h__
@@ -37,6 +37,10 @@
 #include <assert.h>
 #include <fstream>
 #include <stdlib.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 #ifdef GTO_SUPPORT_ZIP
 #include <zlib.h>
 #endif
@@ -161,36 +165,239 @@ bool isGTOFile(const char* infile)
             header.magic == GTO_MAGIC_TEXTl;
 }
 
-void
-swapWords(void *data, size_t size)
+//
+//  Byte swapping. The scalar loops are the fallback; on x86 with gcc
+//  or clang SSE2 and AVX2 kernels are picked at run time. The kernels
+//  handle whole vectors and leave the tail to the scalar loop.
+//
+
+static void
+swap2Scalar(void *data, size_t size)
+{
+    unsigned char* p = reinterpret_cast<unsigned char*>(data);
+
+    for (size_t i=0; i < size; i++, p += 2)
+    {
+        unsigned char t = p[0];
+        p[0] = p[1];
+        p[1] = t;
+    }
+}
+
+static void
+swap4Scalar(void *data, size_t size)
 {
-    struct bytes { char c[4]; };
+    unsigned char* p = reinterpret_cast<unsigned char*>(data);
 
-    bytes* ip = reinterpret_cast<bytes*>(data);
+    for (size_t i=0; i < size; i++, p += 4)
+    {
+        uint32 w;
+        memcpy(&w, p, 4);
+#if defined(__GNUC__)
+        w = __builtin_bswap32(w);
+#else
+        w = (w >> 24) | ((w >> 8) & 0xff00) | ((w << 8) & 0xff0000) | (w << 24);
+#endif
+        memcpy(p, &w, 4);
+    }
+}
+
+static void
+swap8Scalar(void *data, size_t size)
+{
+    unsigned char* p = reinterpret_cast<unsigned char*>(data);
 
-    for (size_t i=0; i<size; i++)
+    for (size_t i=0; i < size; i++, p += 8)
     {
-        bytes temp = ip[i];
-        ip[i].c[0] = temp.c[3];
-        ip[i].c[1] = temp.c[2];
-        ip[i].c[2] = temp.c[1];
-        ip[i].c[3] = temp.c[0];
+        uint64 w;
+        memcpy(&w, p, 8);
+#if defined(__GNUC__)
+        w = __builtin_bswap64(w);
+#else
+        uint32 lo = uint32(w), hi = uint32(w >> 32);
+        swap4Scalar(&lo, 1);
+        swap4Scalar(&hi, 1);
+        w = (uint64(lo) << 32) | hi;
+#endif
+        memcpy(p, &w, 8);
     }
 }
 
-void
-swapShorts(void *data, size_t size)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GTO_SWAP_SIMD
+
+//
+//  SSE2 has no byte shuffle: swap the 16 bit lanes with shufflelo/hi,
+//  then the bytes within each lane with shifts.
+//
+
+__attribute__((target("sse2"))) static inline __m128i
+swapBytes16(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+__attribute__((target("sse2"))) static void
+swap2SSE2(void *data, size_t size)
+{
+    __m128i* p = reinterpret_cast<__m128i*>(data);
+    size_t n   = size / 8;
+
+    for (size_t i=0; i < n; i++)
+    {
+        _mm_storeu_si128(p + i, swapBytes16(_mm_loadu_si128(p + i)));
+    }
+
+    swap2Scalar(reinterpret_cast<char*>(data) + n * 16, size - n * 8);
+}
+
+__attribute__((target("sse2"))) static void
+swap4SSE2(void *data, size_t size)
+{
+    __m128i* p = reinterpret_cast<__m128i*>(data);
+    size_t n   = size / 4;
+
+    for (size_t i=0; i < n; i++)
+    {
+        __m128i v = _mm_loadu_si128(p + i);
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(p + i, swapBytes16(v));
+    }
+
+    swap4Scalar(reinterpret_cast<char*>(data) + n * 16, size - n * 4);
+}
+
+__attribute__((target("sse2"))) static void
+swap8SSE2(void *data, size_t size)
+{
+    __m128i* p = reinterpret_cast<__m128i*>(data);
+    size_t n   = size / 2;
+
+    for (size_t i=0; i < n; i++)
+    {
+        __m128i v = _mm_loadu_si128(p + i);
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        _mm_storeu_si128(p + i, swapBytes16(v));
+    }
+
+    swap8Scalar(reinterpret_cast<char*>(data) + n * 16, size - n * 2);
+}
+
+//
+//  AVX2: one byte shuffle per 32 bytes. The mask repeats per 128 bit
+//  lane.
+//
+
+__attribute__((target("avx2"))) static void
+swapAVX2(void *data, size_t size, size_t width, __m256i mask)
+{
+    __m256i* p = reinterpret_cast<__m256i*>(data);
+    size_t n   = size * width / 32;
+
+    for (size_t i=0; i < n; i++)
+    {
+        _mm256_storeu_si256(p + i, 
+                            _mm256_shuffle_epi8(_mm256_loadu_si256(p + i), mask));
+    }
+}
+
+__attribute__((target("avx2"))) static void
+swap2AVX2(void *data, size_t size)
+{
+    const __m256i mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 
+                                          9, 8, 11, 10, 13, 12, 15, 14,
+                                          1, 0, 3, 2, 5, 4, 7, 6, 
+                                          9, 8, 11, 10, 13, 12, 15, 14);
+    size_t n = size / 16 * 16;
+    swapAVX2(data, n, 2, mask);
+    swap2Scalar(reinterpret_cast<char*>(data) + n * 2, size - n);
+}
+
+__attribute__((target("avx2"))) static void
+swap4AVX2(void *data, size_t size)
+{
+    const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 
+                                          11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 
+                                          11, 10, 9, 8, 15, 14, 13, 12);
+    size_t n = size / 8 * 8;
+    swapAVX2(data, n, 4, mask);
+    swap4Scalar(reinterpret_cast<char*>(data) + n * 4, size - n);
+}
+
+__attribute__((target("avx2"))) static void
+swap8AVX2(void *data, size_t size)
+{
+    const __m256i mask = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 
+                                          15, 14, 13, 12, 11, 10, 9, 8,
+                                          7, 6, 5, 4, 3, 2, 1, 0, 
+                                          15, 14, 13, 12, 11, 10, 9, 8);
+    size_t n = size / 4 * 4;
+    swapAVX2(data, n, 8, mask);
+    swap8Scalar(reinterpret_cast<char*>(data) + n * 8, size - n);
+}
+
+#endif
+
+typedef void (*SwapFunc)(void*, size_t);
+
+struct SwapKernels
 {
-    struct bytes { char c[2]; };
+    SwapFunc    swap2;
+    SwapFunc    swap4;
+    SwapFunc    swap8;
+};
+
+static SwapKernels
+selectSwapKernels()
+{
+    SwapKernels k = { swap2Scalar, swap4Scalar, swap8Scalar };
 
-    bytes* ip = reinterpret_cast<bytes*>(data);
+#ifdef GTO_SWAP_SIMD
+    __builtin_cpu_init();
 
-    for (size_t i=0; i<size; i++)
+    if (__builtin_cpu_supports("avx2"))
     {
-        bytes temp = ip[i];
-        ip[i].c[0] = temp.c[1];
-        ip[i].c[1] = temp.c[0];
+        k.swap2 = swap2AVX2;
+        k.swap4 = swap4AVX2;
+        k.swap8 = swap8AVX2;
     }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        k.swap2 = swap2SSE2;
+        k.swap4 = swap4SSE2;
+        k.swap8 = swap8SSE2;
+    }
+#endif
+
+    return k;
+}
+
+static const SwapKernels&
+swapKernels()
+{
+    static SwapKernels kernels = selectSwapKernels();
+    return kernels;
+}
+
+void
+swapWords(void *data, size_t size)
+{
+    swapKernels().swap4(data, size);
+}
+
+void
+swapShorts(void *data, size_t size)
+{
+    swapKernels().swap2(data, size);
+}
+
+void
+swapDoubleWords(void *data, size_t size)
+{
+    swapKernels().swap8(data, size);
 }
 
 
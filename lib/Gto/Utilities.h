@@ -74,6 +74,7 @@ GTO_API bool isGTOFile(const char*);
 
 GTO_API void swapWords(void *data, size_t size);
 GTO_API void swapShorts(void *data, size_t size);
+GTO_API void swapDoubleWords(void *data, size_t size);   // 8 byte values
 
 
 } // Gto
@@ -38,9 +38,13 @@
 #define _GNU_SOURCE
 #endif
 
-#include "zhacks.h"
 #include "Writer.h"
+#include "BlockFile.h"
+#include "Filters.h"
+#include "Parallel.h"
 #include "Utilities.h"
+#include "SharedStringTable.h"
+#include <algorithm>
 #include <fstream>
 #include <ctype.h>
 #include <stdio.h>
@@ -62,15 +66,114 @@
 #include <sys/stat.h>
 #endif
 
+#ifdef GTO_SUPPORT_HALF
+#include <half.h>
+#endif
+
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
+
 namespace Gto {
 using namespace std;
 
+namespace {
+
+//
+//  Text number formatting. Floating point values are written with
+//  the shortest digits that read back to the same value (to_chars()
+//  where the library has it, otherwise enough digits to round trip).
+//  Each function writes at most 32 chars to out and returns the end.
+//
+
+char*
+formatInt(char* out, int value)
+{
+    char temp[12];
+    char* p = temp + sizeof(temp);
+    unsigned int u = value < 0 ? 0u - unsigned(value) : unsigned(value);
+
+    do
+    {
+        *--p = char('0' + u % 10);
+        u /= 10;
+    } 
+    while (u);
+
+    if (value < 0) *out++ = '-';
+    size_t n = temp + sizeof(temp) - p;
+    memcpy(out, p, n);
+    return out + n;
+}
+
+char*
+finishFloat(char* begin, char* end)
+{
+    //
+    //  A long run of plain digits would read back as an int
+    //  constant, so mark it as floating point
+    //
+
+    size_t digits = 0;
+
+    for (char* p = begin; p != end; ++p)
+    {
+        if (*p == '.' || *p == 'e' || *p == 'n') return end;
+        if (*p != '-') digits++;
+    }
+
+    if (digits > 9)
+    {
+        *end++ = '.';
+        *end++ = '0';
+    }
+
+    return end;
+}
+
+char*
+formatFloat(char* out, float value)
+{
+#ifdef __cpp_lib_to_chars
+    char* end = std::to_chars(out, out + 30, value).ptr;
+#else
+    char* end = out + snprintf(out, 30, "%.9g", double(value));
+#endif
+    return finishFloat(out, end);
+}
+
+char*
+formatDouble(char* out, double value)
+{
+#ifdef __cpp_lib_to_chars
+    char* end = std::to_chars(out, out + 30, value).ptr;
+#else
+    char* end = out + snprintf(out, 30, "%.17g", value);
+#endif
+    return finishFloat(out, end);
+}
+
+template <typename T>
+inline T
+valueAt(const char* p)
+{
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+} // anonymous namespace
+
 
 Writer::Writer()
     : m_out(0),
       m_gzfile(0),
       m_gzRawFd(-1),
+      m_blocks(0),
       m_currentProperty(0),
+      m_compressionThreads(0),
       m_type(BinaryGTO),
       m_needsClosing(false),
       m_error(false),
@@ -78,7 +181,10 @@ Writer::Writer()
       m_endDataCalled(false),
       m_beginDataCalled(false),
       m_objectActive(false),
-      m_componentActive(false)
+      m_componentActive(false),
+      m_streaming(false),
+      m_bytesWritten(0),
+      m_sharedStrings(0)
 {
     init(0);
 }
@@ -87,7 +193,9 @@ Writer::Writer(ostream &o)
     : m_out(0),
       m_gzfile(0),
       m_gzRawFd(-1),
+      m_blocks(0),
       m_currentProperty(0),
+      m_compressionThreads(0),
       m_type(BinaryGTO),
       m_needsClosing(true),
       m_error(false),
@@ -95,7 +203,10 @@ Writer::Writer(ostream &o)
       m_endDataCalled(false),
       m_beginDataCalled(false),
       m_objectActive(false),
-      m_componentActive(false)
+      m_componentActive(false),
+      m_streaming(false),
+      m_bytesWritten(0),
+      m_sharedStrings(0)
 {
     init(&o);
 }
@@ -114,17 +225,28 @@ Writer::init(ostream *o)
 bool
 Writer::open(const char* filename, FileType type, bool writeIndex)
 {
-    if (m_out || m_gzfile) return false;
+    if (m_out || m_gzfile || m_blocks) return false;
 
-    m_outName         = filename;
-    m_type            = type;
-    m_writeIndexTable = writeIndex;
-    m_gzRawFd         = -1;
+    if ((type == LZ4CompressedGTO || type == ZstdCompressedGTO) &&
+        !supports(type))
+    {
+        std::cerr << "ERROR: Gto::Writer: can't write " << filename
+                  << ", the library was built without the "
+                  << (type == LZ4CompressedGTO ? "LZ4" : "Zstd")
+                  << " codec" << std::endl;
+        m_error = true;
+        return false;
+    }
 
 #ifndef GTO_SUPPORT_ZIP
     if (type == CompressedGTO) type = BinaryGTO;
 #endif
 
+    m_outName         = filename;
+    m_type            = type;
+    m_writeIndexTable = writeIndex;
+    m_gzRawFd         = -1;
+
     if (type == BinaryGTO || type == TextGTO)
     {
         if (type == BinaryGTO)
@@ -144,8 +266,12 @@ Writer::open(const char* filename, FileType type, bool writeIndex)
         }
     }
 #ifdef GTO_SUPPORT_ZIP
-    else if (type == CompressedGTO)
+    else
     {
+        //
+        //  Any of the compressed types
+        //
+
 #ifdef _WIN32
         m_gzRawFd = ::_open( filename, _O_WRONLY|_O_CREAT|_O_TRUNC );
 #else
@@ -167,6 +293,31 @@ Writer::open(const char* filename, FileType type, bool writeIndex)
     return true;
 }
 
+bool
+Writer::supports(FileType type)
+{
+    switch (type)
+    {
+      case BinaryGTO:
+      case TextGTO:
+          return true;
+#ifdef GTO_SUPPORT_ZIP
+      case CompressedGTO:
+          return true;
+#endif
+#if defined(GTO_SUPPORT_ZIP) && defined(GTO_SUPPORT_LZ4)
+      case LZ4CompressedGTO:
+          return true;
+#endif
+#if defined(GTO_SUPPORT_ZIP) && defined(GTO_SUPPORT_ZSTD)
+      case ZstdCompressedGTO:
+          return true;
+#endif
+      default:
+          return false;
+    }
+}
+
 void
 Writer::close()
 {
@@ -214,7 +365,15 @@ void
 Writer::beginData(const std::string *orderedStrings, int num)
 {
     m_currentProperty = 0;
-    constructStringTable(orderedStrings, num);
+
+    if (m_streaming)
+    {
+        for (int i=0; i < num; i++) streamString(orderedStrings[i]);
+    }
+    else
+    {
+        constructStringTable(orderedStrings, num);
+    }
 
     if (m_type == TextGTO)
     {
@@ -223,17 +382,44 @@ Writer::beginData(const std::string *orderedStrings, int num)
     else
     {
 #ifdef GTO_SUPPORT_ZIP
-        if (m_type == CompressedGTO)
+        if (m_type == CompressedGTO && !m_writeIndexTable && !m_streaming)
         {
 #ifdef _WIN32
             m_gzfile = gzdopen(_dup(m_gzRawFd), "w");
 #else
             m_gzfile = gzdopen(dup(m_gzRawFd), "w");
 #endif
-            prepIndexTable();
+        }
+        else if (m_type != BinaryGTO)
+        {
+            //
+            //  Indexed gzip, LZ4 and Zstd files are block compressed
+            //  (see BlockFile.h)
+            //
+
+            BlockCodecType codec = GzipBlocks;
+            if (m_type == LZ4CompressedGTO) codec = LZ4Blocks;
+            if (m_type == ZstdCompressedGTO) codec = ZstdBlocks;
+
+            unsigned int threads = m_compressionThreads ? 
+                m_compressionThreads : defaultThreadCount();
+
+            m_blocks = new BlockWriter(m_gzRawFd, BlockCodec::find(codec),
+                                       -1, threads);
         }
 #endif
-        writeHead();
+        if (m_streaming)
+        {
+            Header header;
+            memset(&header, 0, sizeof(Header));
+            header.magic   = GTO_MAGIC;
+            header.version = GTO_VERSION_STREAMED;
+            write(&header, sizeof(Header));
+        }
+        else
+        {
+            writeHead();
+        }
     }
 
     m_beginDataCalled = true;
@@ -242,14 +428,30 @@ Writer::beginData(const std::string *orderedStrings, int num)
 void
 Writer::endData()
 {
+    if (m_streaming && !m_beginDataCalled) beginData();
+
     if (m_type == TextGTO)
     {
         writeText("    }\n}\n");
     }
-    else if (m_type == CompressedGTO)
+    else if (m_streaming)
+    {
+        writeStreamDescription();
+    }
+
+#ifdef GTO_SUPPORT_ZIP
+    if (m_blocks)
+    {
+        if (!m_blocks->finish()) m_error = true;
+        delete m_blocks;
+        m_blocks = 0;
+    }
+    else if (m_gzfile)
     {
-        writeIndexTable();
+        gzclose( (gzFile)m_gzfile );
+        m_gzfile = 0;
     }
+#endif
 
     m_endDataCalled = true;
 }
@@ -257,42 +459,53 @@ Writer::endData()
 void
 Writer::intern(const char* s)
 {
+    if (m_streaming)
+    {
+        streamString(s);
+        return;
+    }
+
     if (m_tableFinished)
     {
         throw std::runtime_error("Gto::Writer::intern(): Unable to intern "
                                  "strings after string table is finished");
     }
 
+    if (m_sharedStrings && m_sharedStrings->lookup(s) != -1) return;
     m_strings[s] = -1;
 }
 
 void
 Writer::intern(const string& s)
 {
+    if (m_streaming)
+    {
+        streamString(s);
+        return;
+    }
+
     if (m_tableFinished)
     {
         throw std::runtime_error("Gto::Writer::intern(): Unable to intern "
                                  "strings after string table is finished");
     }
 
+    if (m_sharedStrings && m_sharedStrings->lookup(s) != -1) return;
     m_strings[s] = -1;
 }
 
 int
 Writer::lookup(const char* s) const
 {
-    if (m_tableFinished)
-    {
-        StringMap::const_iterator i = m_strings.find(s);
+    return lookup(string(s));
+}
 
-        if (i == m_strings.end())
-        {
-            return -1;
-        }
-        else
-        {
-            return i->second;
-        }
+int
+Writer::lookup(const string& s) const
+{
+    if (m_tableFinished || m_streaming)
+    {
+        return stringId(s);
     }
     else
     {
@@ -301,25 +514,34 @@ Writer::lookup(const char* s) const
 }
 
 int
-Writer::lookup(const string& s) const
+Writer::stringId(const string& s) const
 {
-    if (m_tableFinished)
+    if (m_sharedStrings)
     {
-        StringMap::const_iterator i = m_strings.find(s);
+        int id = m_sharedStrings->lookup(s);
+        if (id != -1) return id;
+    }
 
-        if (i == m_strings.end())
-        {
-            return -1;
-        }
-        else
-        {
-            return i->second;
-        }
+    StringMap::const_iterator i = m_strings.find(s);
+    return i == m_strings.end() ? -1 : i->second;
+}
+
+void
+Writer::setSharedStringTable(const SharedStringTable* table)
+{
+    if (table && !table->isFinished())
+    {
+        throw std::runtime_error("Gto::Writer::setSharedStringTable(): "
+                                 "the table must be finished first");
     }
-    else
+
+    if (m_beginDataCalled || (m_streaming && !m_names.empty()))
     {
-        return -1;
+        throw std::runtime_error("Gto::Writer::setSharedStringTable(): "
+                                 "must be called before declaring anything");
     }
+
+    m_sharedStrings = table;
 }
 
 std::string
@@ -346,14 +568,11 @@ Writer::beginObject(const char* name,
                                  "beginComponent() still active");
     }
 
-    m_names.push_back(name);
-    m_names.push_back(protocol);
-
     ObjectHeader header;
     memset(&header, 0, sizeof(ObjectHeader));
     header.numComponents   = 0;
-    header.name            = Gto::uint32(m_names.size() - 2);
-    header.protocolName    = Gto::uint32(m_names.size() - 1);
+    header.name            = declareName(name);
+    header.protocolName    = declareName(protocol);
     header.protocolVersion = version;
 
     m_objects.push_back(header);
@@ -383,19 +602,17 @@ Writer::beginComponent(const char* name,
                                  "you forgot to call endComponent()");
     }
 
-    m_names.push_back(name);
     m_objects.back().numComponents++;
     ComponentHeader header;
     memset(&header, 0, sizeof(ComponentHeader));
 
     header.numProperties = 0;
     header.flags         = flags;
-    header.name          = Gto::uint32(m_names.size() - 1);
+    header.name          = declareName(name);
     header.pad           = 0;
 
     if (!interp) interp = "";
-    m_names.push_back(interp);
-    header.interpretation = Gto::uint32(m_names.size() - 1);
+    header.interpretation = declareName(interp);
 
     m_components.push_back(header);
     m_componentActive = true;
@@ -404,6 +621,23 @@ Writer::beginComponent(const char* name,
 void
 Writer::endComponent()
 {
+    const ComponentHeader& c = m_components.back();
+
+    if ((c.flags & Transposed) && c.numProperties)
+    {
+        for (size_t i=m_properties.size() - c.numProperties; 
+             i < m_properties.size(); 
+             i++)
+        {
+            if (m_properties[i].size != m_properties.back().size)
+            {
+                throw std::runtime_error("ERROR: Gto::Writer::endComponent() -- "
+                                         "properties of a transposed component "
+                                         "must have the same size");
+            }
+        }
+    }
+
     m_componentActive = false;
 }
 
@@ -418,7 +652,8 @@ Writer::property(const char* name,
                  DataType type,
                  size_t numElements,
                  size_t partsPerElement,
-                 const char *interp)
+                 const char *interp,
+                 unsigned int filters)
 {
     if (!m_objectActive || !m_componentActive)
     {
@@ -426,7 +661,6 @@ Writer::property(const char* name,
                                  "no active component or object");
     }
 
-    m_names.push_back(name);
     m_components.back().numProperties++;
 
     PropertyHeader header;
@@ -434,14 +668,16 @@ Writer::property(const char* name,
     header.size   = Gto::uint32(numElements);
     header.type   = type;
     header.width  = Gto::uint32(partsPerElement);
-    header.name   = Gto::uint32(m_names.size() - 1);
-    header.pad    = 0;
+    header.name   = declareName(name);
+    header.pad    = filters & (ShuffleFilter | DeltaFilter);
+
+    if (m_components.back().flags & Transposed) header.pad = 0;
 
     if (!interp) interp = "";
-    m_names.push_back(interp);
-    header.interpretation = Gto::uint32(m_names.size() - 1);
+    header.interpretation = declareName(interp);
 
     m_properties.push_back(header);
+    m_propertyComponents.push_back(m_components.size() - 1);
 
     if (m_type == TextGTO)
     {
@@ -452,6 +688,45 @@ Writer::property(const char* name,
 }
 
 
+uint32
+Writer::declareName(const char* name)
+{
+    //
+    //  Names are numbered by constructStringTable() unless streaming,
+    //  when they get their final ids right away
+    //
+
+    if (m_streaming) return Gto::uint32(streamString(name));
+    m_names.push_back(name);
+    return Gto::uint32(m_names.size() - 1);
+}
+
+int
+Writer::streamString(const std::string& s)
+{
+    if (m_sharedStrings)
+    {
+        if (m_names.empty()) m_names = m_sharedStrings->strings();
+        int id = m_sharedStrings->lookup(s);
+        if (id != -1) return id;
+    }
+
+    StringMap::const_iterator i = m_strings.find(s);
+    if (i != m_strings.end()) return i->second;
+
+    int id = int(m_names.size());
+    m_strings[s] = id;
+    m_names.push_back(s);
+    return id;
+}
+
+void
+Writer::setQuantization(const char* interpretation, int mantissaBits)
+{
+    if (mantissaBits < 0) m_quantize.erase(interpretation);
+    else m_quantize[interpretation] = mantissaBits;
+}
+
 void
 Writer::constructStringTable(const std::string *orderedStrings, int num)
 {
@@ -468,6 +743,13 @@ Writer::constructStringTable(const std::string *orderedStrings, int num)
                                  "but string list was null");
     }
 
+    if (num > 0 && m_sharedStrings)
+    {
+        throw std::runtime_error("Gto::Writer::constructStringTable(): "
+                                 "ordered strings can't be used with a "
+                                 "shared string table");
+    }
+
     intern( "(Gto::Writer compiled " __DATE__
             " " __TIME__
             ", $Id: Writer.cpp,v 1.37 2008/04/11 23:25:24 src Exp $)" );
@@ -486,6 +768,22 @@ Writer::constructStringTable(const std::string *orderedStrings, int num)
     int count = 0;
     size_t bytes = 0;
 
+    //
+    //  Shared strings come first with the ids they have in the table.
+    //  Anything interned before the table was set is dropped here.
+    //
+
+    if (m_sharedStrings)
+    {
+        count = int(m_sharedStrings->size());
+
+        for (StringMap::iterator i = m_strings.begin(); i != m_strings.end();)
+        {
+            if (m_sharedStrings->lookup(i->first) != -1) m_strings.erase(i++);
+            else ++i;
+        }
+    }
+
     //
     // populate the first entries with the given ordered strings
     //
@@ -522,20 +820,20 @@ Writer::constructStringTable(const std::string *orderedStrings, int num)
     for (size_t o=0, c=0, p=0, n=0; o < m_objects.size(); o++)
     {
         ObjectHeader &oh = m_objects[o];
-        oh.name = m_strings[m_names[n++]];
-        oh.protocolName = m_strings[m_names[n++]];
+        oh.name = stringId(m_names[n++]);
+        oh.protocolName = stringId(m_names[n++]);
 
         for (size_t i=0; i < oh.numComponents; i++, c++)
         {
             ComponentHeader &ch = m_components[c];
-            ch.name = m_strings[m_names[n++]];
-            ch.interpretation = m_strings[m_names[n++]];
+            ch.name = stringId(m_names[n++]);
+            ch.interpretation = stringId(m_names[n++]);
 
             for (size_t q=0; q < ch.numProperties; q++, p++)
             {
                 PropertyHeader &ph = m_properties[p];
-                ph.name = m_strings[m_names[n++]];
-                ph.interpretation = m_strings[m_names[n++]];
+                ph.name = stringId(m_names[n++]);
+                ph.interpretation = stringId(m_names[n++]);
             }
         }
     }
@@ -544,7 +842,8 @@ Writer::constructStringTable(const std::string *orderedStrings, int num)
     //  Reformat the m_names to do inverse lookups for debugging
     //
 
-    m_names.resize(m_strings.size());
+    if (m_sharedStrings) m_names = m_sharedStrings->strings();
+    m_names.resize(count);
 
     for (StringMap::iterator i = m_strings.begin();
          i != m_strings.end();
@@ -658,6 +957,10 @@ Writer::writeText(const std::string& s)
         (*m_out) << s;
     }
 #ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        if (!m_blocks->write(s.c_str(), s.size())) m_error = true;
+    }
     else if (m_gzfile)
     {
         gzwrite( (gzFile)m_gzfile, (void*)s.c_str(), (unsigned)s.size() );
@@ -665,6 +968,66 @@ Writer::writeText(const std::string& s)
 #endif
 }
 
+void
+Writer::writeTextValues(const PropertyHeader& info, const char* data, size_t n)
+{
+    //
+    //  Numbers are formatted into m_textBuffer and written out in
+    //  large pieces instead of one formatted write per value
+    //
+
+    const size_t flushSize = 1 << 16;
+    const size_t ds        = dataSize(info.type);
+    const size_t width     = info.width;
+    const DataType type    = DataType(info.type);
+
+    m_textBuffer.resize(flushSize + 64);
+    char* begin = &m_textBuffer.front();
+    char* out   = begin;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const char* p = data + i * ds;
+
+        if (width > 1 && i % width == 0)
+        {
+            if (i) { *out++ = ' '; *out++ = ']'; }
+            *out++ = ' ';
+            *out++ = '[';
+        }
+
+        *out++ = ' ';
+
+        switch (type)
+        {
+          case Float:  out = formatFloat(out, valueAt<float>(p)); break;
+          case Double: out = formatDouble(out, valueAt<double>(p)); break;
+          case Int:    out = formatInt(out, valueAt<int>(p)); break;
+          case Short:  out = formatInt(out, valueAt<short>(p)); break;
+          case Byte:   out = formatInt(out, valueAt<unsigned char>(p)); break;
+#ifdef GTO_SUPPORT_HALF
+          case Half:   out = formatFloat(out, float(valueAt<half>(p))); break;
+#endif
+          default:
+              {
+                  Number num = asNumber((void*)p, type);
+
+                  out = num.type == Int ? formatInt(out, num._int)
+                                        : formatDouble(out, num._double);
+              }
+              break;
+        }
+
+        if (size_t(out - begin) >= flushSize)
+        {
+            write(begin, out - begin);
+            out = begin;
+        }
+    }
+
+    write(begin, out - begin);
+}
+
 void
 Writer::writeFormatted(const char* format, ...)
 {
@@ -683,14 +1046,33 @@ void
 Writer::write(const void* p, size_t s)
 {
     if( s == 0 ) return;
+    m_bytesWritten += s;
+
     if (m_out)
     {
         m_out->write((const char*)p, s);
     }
 #ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        if (!m_blocks->write(p, s)) m_error = true;
+    }
     else if (m_gzfile)
     {
-        gzwrite( (gzFile)m_gzfile, (void*)p, (unsigned)s );
+        //
+        //  gzwrite() takes an unsigned count and returns an int so
+        //  very large properties are fed to it in pieces
+        //
+
+        const char* cp = (const char*)p;
+
+        while (s)
+        {
+            unsigned chunk = s > (1u << 30) ? (1u << 30) : unsigned(s);
+            gzwrite( (gzFile)m_gzfile, (void*)cp, chunk );
+            cp += chunk;
+            s  -= chunk;
+        }
     }
 #endif
 }
@@ -698,12 +1080,18 @@ Writer::write(const void* p, size_t s)
 void
 Writer::write(const std::string& s)
 {
+    m_bytesWritten += s.size() + 1;
+
     if (m_out)
     {
         (*m_out) << s;
         m_out->put(0);
     }
 #ifdef GTO_SUPPORT_ZIP
+    else if (m_blocks)
+    {
+        if (!m_blocks->write(s.c_str(), s.size() + 1)) m_error = true;
+    }
     else if (m_gzfile)
     {
         gzwrite( (gzFile)m_gzfile, (void*)s.c_str(), (unsigned)s.size() + 1 );
@@ -723,10 +1111,15 @@ Writer::writeHead()
     Header header;
     header.magic         = GTO_MAGIC;
     header.numObjects    = Gto::uint32(m_objects.size());
-    header.numStrings    = Gto::uint32(m_strings.size());
+    header.numStrings    = Gto::uint32(m_names.size());
     header.version       = GTO_VERSION;
     header.flags         = 0;
 
+    for (size_t i=0; i < m_properties.size(); i++)
+    {
+        if (m_properties[i].pad) header.version = GTO_VERSION_FILTERED;
+    }
+
     write(&header, sizeof(Header));
 
     for (StringVector::iterator i = m_names.begin();
@@ -757,6 +1150,35 @@ Writer::writeHead()
     flush();
 }
 
+void
+Writer::writeStreamDescription()
+{
+    intern( "(Gto::Writer compiled " __DATE__
+            " " __TIME__
+            ", $Id: Writer.cpp,v 1.37 2008/04/11 23:25:24 src Exp $)" );
+
+    if (m_currentProperty != m_properties.size())
+    {
+        std::cerr << "ERROR: Gto::Writer: stream ended with " 
+                  << (m_properties.size() - m_currentProperty)
+                  << " properties missing their data" << std::endl;
+        m_error = true;
+    }
+
+#ifdef GTO_SUPPORT_ZIP
+    if (m_blocks && !m_blocks->startBlock()) m_error = true;
+#endif
+
+    StreamFooter footer;
+    footer.descriptionOffset = m_bytesWritten;
+    footer.magic             = GTO_MAGIC;
+    footer.pad               = 0;
+
+    writeHead();
+    write(&footer, sizeof(StreamFooter));
+    flush();
+}
+
 bool
 Writer::propertySanityCheck(const char *propertyName, int size, int width)
 {
@@ -803,9 +1225,28 @@ Writer::propertyDataRaw(const void* data,
 {
     if (!m_beginDataCalled) beginData();
 
+    if (m_currentProperty >= m_properties.size())
+    {
+        std::cerr << "ERROR: Gto::Writer: propertyData called for a "
+                  << "property that has not been declared" << std::endl;
+        m_error = true;
+        return;
+    }
+
+    if (m_streaming && m_componentActive &&
+        m_propertyComponents[m_currentProperty] == m_components.size() - 1 &&
+        (m_components.back().flags & Transposed))
+    {
+        std::cerr << "ERROR: Gto::Writer: data for transposed component '"
+                  << m_names[m_components.back().name] << "' given before "
+                  << "endComponent() while streaming" << std::endl;
+        m_error = true;
+        return;
+    }
+
     size_t                p     = m_currentProperty++;
     const PropertyHeader& info  = m_properties[p];
-    size_t                n     = info.size * info.width;
+    size_t                n     = size_t(info.size) * info.width;
     size_t                ds    = dataSize(info.type);
     char*                 bdata = (char*)data;
 
@@ -860,157 +1301,459 @@ Writer::propertyDataRaw(const void* data,
             if (n == 0) writeText(" [ ]");
             if (n > 1) writeText(" [");
 
-            for (size_t i = 0; i < n; i++)
+            if (info.type == String)
             {
-                if (info.width > 1)
+                for (size_t i = 0; i < n; i++)
                 {
-                    if (i % info.width == 0)
+                    if (info.width > 1 && i % info.width == 0)
                     {
-                        if (i) writeFormatted(" ]");
-                        writeFormatted(" [");
+                        writeText(i ? " ] [" : " [");
                     }
+
+                    writeText(" ");
+                    writeQuotedString(lookup(valueAt<int>(bdata + i * ds)));
+                }
+            }
+            else
+            {
+                writeTextValues(info, bdata, n);
+            }
+
+            if (n > 0 && info.width > 1) writeText(" ]");
+            if (n > 1) writeText(" ]");
+
+            writeText("\n");
+        }
+        else
+        {
+            int bits    = quantizationBits(info);
+            size_t ci = m_propertyComponents[p];
+
+            if (m_components[ci].flags & Transposed)
+            {
+                //
+                //  Collect the component's properties and write them
+                //  interleaved once the last one arrives
+                //
+
+                size_t first = p;
+                while (first && m_propertyComponents[first - 1] == ci) first--;
+                if (p == first) m_transposeBuffer.clear();
+
+                size_t at = m_transposeBuffer.size();
+                m_transposeBuffer.resize(at + ds * n);
+
+                if (n && data)
+                {
+                    char* tdata = &m_transposeBuffer[at];
+                    memcpy(tdata, data, ds * n);
+                    if (info.type == Float) quantizeFloats((float32*)tdata, n, bits);
+                    if (info.type == Double) quantizeDoubles((float64*)tdata, n, bits);
                 }
 
-                if (isNumber(DataType(info.type)))
+                if (p + 1 == m_properties.size() || 
+                    m_propertyComponents[p + 1] != ci)
                 {
-                    Number num = asNumber(bdata + (i * ds),
-                                          DataType(info.type));
+                    writeTransposed(first, p + 1);
+                }
+            }
+            else
+            {
+#ifdef GTO_SUPPORT_ZIP
+                if (m_blocks && !m_blocks->startBlock()) m_error = true;
+#endif
+                if (n && data && (info.pad || bits >= 0))
+                {
+                    //
+                    //  Filters work on a copy; the caller's data is const
+                    //
+
+                    m_filterBuffer.resize(ds * n);
+                    char* fdata = &m_filterBuffer.front();
+                    memcpy(fdata, data, ds * n);
 
-                    if (num.type == Int)
+                    if (info.type == Float) quantizeFloats((float32*)fdata, n, bits);
+                    if (info.type == Double) quantizeDoubles((float64*)fdata, n, bits);
+
+                    if (info.pad & DeltaFilter)
                     {
-                        writeFormatted(" %d", num._int);
+                        deltaEncode(fdata, n, info.width, ds);
                     }
-                    else
+
+                    if ((info.pad & ShuffleFilter) && ds > 1)
                     {
-                        writeFormatted(" %g", double(num._double));
+                        std::vector<char> shuffled(ds * n);
+                        shuffleBytes(fdata, &shuffled.front(), n, ds);
+                        m_filterBuffer.swap(shuffled);
                     }
+
+                    write(&m_filterBuffer.front(), ds * n);
                 }
                 else
                 {
-                    char* s = bdata + (i*ds);
-                    writeText(" ");
-                    writeQuotedString(lookup(*(int*)s));
+                    write(data, ds * n);
                 }
             }
+        }
+    }
+}
 
-            if (n > 0 && info.width > 1) writeText(" ]");
-            if (n > 1) writeText(" ]");
+bool
+Writer::canWriteDirect(size_t bytes) const
+{
+    //
+    //  Only plain binary data of the expected size goes out as is
+    //
 
-            writeText("\n");
+    size_t p = m_currentProperty;
+    if (m_type == TextGTO || p >= m_properties.size()) return false;
+
+    const PropertyHeader& info = m_properties[p];
+
+    if (info.pad || 
+        bytes != size_t(info.size) * info.width * dataSize(info.type) ||
+        (m_components[m_propertyComponents[p]].flags & Transposed))
+    {
+        return false;
+    }
+
+    return quantizationBits(info) < 0;
+}
+
+int
+Writer::quantizationBits(const PropertyHeader& info) const
+{
+    if (info.type != Float && info.type != Double) return -1;
+    StringMap::const_iterator i = m_quantize.find(m_names[info.interpretation]);
+    return i != m_quantize.end() ? i->second : -1;
+}
+
+bool
+Writer::beginDirectWrite(const char *propertyName, int size, int width)
+{
+    if (!m_beginDataCalled) beginData();
+    m_currentProperty++;
+    if (!propertySanityCheck(propertyName, size, width)) return false;
+
+#ifdef GTO_SUPPORT_ZIP
+    if (m_blocks && !m_blocks->startBlock()) m_error = true;
+#endif
+    return true;
+}
+
+void
+Writer::propertyDataSpans(const Span* spans, 
+                          size_t numSpans,
+                          const char *propertyName,
+                          int size,
+                          int width)
+{
+    size_t bytes = 0;
+    for (size_t i=0; i < numSpans; i++) bytes += spans[i].bytes;
+
+    if (numSpans == 1 && spans[0].bytes == bytes)
+    {
+        propertyDataRaw(spans[0].data, propertyName, size, width);
+    }
+    else if (canWriteDirect(bytes))
+    {
+        if (!beginDirectWrite(propertyName, size, width)) return;
+
+        //
+        //  Small spans are packed into one staging buffer so the
+        //  stream (or compressor) sees a few large writes; spans at
+        //  least as big as the buffer go out as they are
+        //
+
+        const size_t staging = 1 << 16;
+        m_filterBuffer.resize(staging);
+        char* stage = &m_filterBuffer.front();
+        size_t staged = 0;
+
+        for (size_t i=0; i < numSpans; i++)
+        {
+            size_t n = spans[i].bytes;
+
+            if (staged && staged + n > staging)
+            {
+                write(stage, staged);
+                staged = 0;
+            }
+
+            if (n >= staging)
+            {
+                write(spans[i].data, n);
+            }
+            else if (n)
+            {
+                memcpy(stage + staged, spans[i].data, n);
+                staged += n;
+            }
         }
-        else
+
+        write(stage, staged);
+    }
+    else
+    {
+        std::vector<char> buffer(bytes);
+
+        for (size_t i=0, at=0; i < numSpans; at += spans[i].bytes, i++)
         {
-#ifdef GTO_SUPPORT_ZIP
-            if( (m_type == CompressedGTO) && m_writeIndexTable )
+            if (spans[i].bytes) memcpy(&buffer[at], spans[i].data, spans[i].bytes);
+        }
+
+        if (m_currentProperty < m_properties.size())
+        {
+            const PropertyHeader& info = m_properties[m_currentProperty];
+
+            if (bytes != size_t(info.size) * info.width * dataSize(info.type))
             {
-                gzflush( (gzFile)m_gzfile, Z_FULL_FLUSH );
-#ifdef _WIN32
-                m_dataOffsets.push_back( _lseek( m_gzRawFd, 0, SEEK_CUR ));
-#else
-                m_dataOffsets.push_back(lseek(m_gzRawFd, 0, SEEK_CUR));
-#endif
+                std::cerr << "ERROR: Gto::Writer: propertyDataSpans got "
+                          << bytes << " bytes for property '" 
+                          << m_names[info.name] << "'" << std::endl;
+                m_error = true;
+                m_currentProperty++;
+                return;
             }
-#endif
-            write(data, dataSize(m_properties[p].type) * n);
         }
+
+        propertyDataRaw(buffer.empty() ? 0 : &buffer.front(), 
+                        propertyName, size, width);
     }
 }
 
-
 void
-Writer::prepIndexTable()
+Writer::propertyDataStrided(const void* data,
+                            size_t strideBytes,
+                            const char *propertyName,
+                            int size,
+                            int width)
 {
-#ifdef GTO_SUPPORT_ZIP
-    // See zhacks.h for details
+    size_t p = m_currentProperty;
 
-    if( ! m_writeIndexTable ) return;
-    gz_stream *s = (gz_stream*)m_gzfile;
+    if (p >= m_properties.size() || !data)
+    {
+        propertyDataRaw(data, propertyName, size, width);
+        return;
+    }
 
-    //
-    // Write the FLG header field
-    //
-    fseek(s->gto_z_file, 3L, SEEK_SET);
-    fprintf(s->gto_z_file, "%c", EXTRA_FIELD);
+    const PropertyHeader& info = m_properties[p];
+    size_t es    = info.width * dataSize(info.type);
+    size_t count = info.size;
+    const char* src = (const char*)data;
+
+    if (strideBytes == es)
+    {
+        propertyDataRaw(data, propertyName, size, width);
+        return;
+    }
+
+    if (!canWriteDirect(es * count))
+    {
+        std::vector<char> buffer(es * count);
+        for (size_t i=0; i < count; i++) memcpy(&buffer[i * es], src + i * strideBytes, es);
+        propertyDataRaw(buffer.empty() ? 0 : &buffer.front(), 
+                        propertyName, size, width);
+        return;
+    }
+
+    if (!beginDirectWrite(propertyName, size, width) || !es) return;
 
     //
-    // Write the XLEN extra field length
+    //  Gather a chunk of elements at a time
     //
-    unsigned short xlen = 2 * sizeof(unsigned int);
-    fseek(s->gto_z_file, 10L, SEEK_SET);
-    fwrite(&xlen, 1, sizeof(unsigned short), s->gto_z_file);
 
+    size_t chunkSize = std::max(size_t(1), size_t(64 * 1024) / es);
+    std::vector<char> chunk(chunkSize * es);
+
+    for (size_t r=0; r < count; r += chunkSize)
+    {
+        size_t n = std::min(chunkSize, count - r);
+
+        for (size_t i=0; i < n; i++)
+        {
+            memcpy(&chunk[i * es], src + (r + i) * strideBytes, es);
+        }
+
+        write(&chunk.front(), n * es);
+    }
+}
+
+void
+Writer::writeTransposed(size_t first, size_t last)
+{
     //
-    // Leave space for the index table offset and size
+    //  m_transposeBuffer holds the properties first..last one after
+    //  the other. Interleave a chunk of elements at a time.
     //
-    unsigned int placeholders[2] = {0, 0};
-    fwrite(placeholders, sizeof(unsigned int), 2, s->gto_z_file);
 
-    gzflush( (gzFile)m_gzfile, Z_FULL_FLUSH );
-    s->gto_start = ftell(s->gto_z_file);
+    size_t count  = m_properties[first].size;
+    size_t stride = 0;
+    std::vector<size_t> offsets;
+
+    for (size_t i=first; i < last; i++)
+    {
+        offsets.push_back(stride * count);
+        stride += m_properties[i].width * dataSize(m_properties[i].type);
+    }
+
+#ifdef GTO_SUPPORT_ZIP
+    if (m_blocks && !m_blocks->startBlock()) m_error = true;
 #endif
-}
 
+    if (!stride || !count) return;
+
+    size_t chunkSize = std::max(size_t(1), size_t(64 * 1024) / stride);
+    std::vector<char> chunk(chunkSize * stride);
+
+    for (size_t r=0; r < count; r += chunkSize)
+    {
+        size_t n      = std::min(chunkSize, count - r);
+        size_t column = 0;
+
+        for (size_t i=first; i < last; i++)
+        {
+            const PropertyHeader& info = m_properties[i];
+            size_t es       = info.width * dataSize(info.type);
+            const char* src = &m_transposeBuffer[offsets[i - first]] + r * es;
+            char* dst       = &chunk.front() + column;
+
+            for (size_t q=0; q < n; q++) memcpy(dst + q * stride, src + q * es, es);
+            column += es;
+        }
+
+        write(&chunk.front(), n * stride);
+    }
+
+    m_transposeBuffer.clear();
+}
 
 void
-Writer::writeIndexTable()
+Writer::componentDataRaw(const void* data, const char* componentName)
 {
-#ifdef GTO_SUPPORT_ZIP
-    // See zhacks.h for details
+    if (!m_beginDataCalled) beginData();
 
-    if( ! m_writeIndexTable ) return;
-    assert(m_dataOffsets.size() == m_properties.size());
+    size_t p = m_currentProperty;
 
-    //
-    // Lay down a gzip marker and remember where it is
-    //
-    gzflush( (gzFile)m_gzfile, Z_FULL_FLUSH );
-#ifdef _WIN32
-    unsigned int indexTableOffset = _lseek(m_gzRawFd, 0, SEEK_CUR);
-#else
-    unsigned int indexTableOffset = lseek(m_gzRawFd, 0, SEEK_CUR);
-#endif
-    unsigned int indexTableSize = (unsigned)m_dataOffsets.size();
+    if (p >= m_properties.size())
+    {
+        std::cerr << "ERROR: Gto::Writer: componentDataRaw called after "
+                  << "the last property" << std::endl;
+        m_error = true;
+        return;
+    }
 
-    //
-    // Always store offsets as little-endian
-    //
-    unsigned short needsSwap = 0xFF00;
-    if( *(unsigned char*)(&needsSwap) )
+    size_t ci                 = m_propertyComponents[p];
+    const ComponentHeader& c  = m_components[ci];
+
+    if ((p && m_propertyComponents[p - 1] == ci) ||
+        !(c.flags & Transposed) ||
+        (m_componentActive && ci == m_components.size() - 1) ||
+        (componentName && m_names[c.name] != componentName))
     {
-        swapWords(&m_dataOffsets.front(), m_dataOffsets.size());
-        swapWords(&indexTableOffset, 1);
-        swapWords(&indexTableSize, 1);
+        std::cerr << "ERROR: Gto::Writer: componentDataRaw expected data "
+                  << "for property '" << m_names[m_properties[p].name] 
+                  << "' of component '" << m_names[c.name] 
+                  << "' which must be the first property of a transposed "
+                  << "component that has been ended" << std::endl;
+        m_error = true;
+        return;
     }
 
-    //
-    // Write the index table into the gzip stream
-    //
-    /*int w =*/ gzwrite( (gzFile)m_gzfile, &m_dataOffsets.front(), (unsigned)(m_dataOffsets.size() * sizeof(unsigned int)) );
+    size_t count  = m_properties[p].size;
+    size_t stride = 0;
 
-    //
-    // Close the gzip file.  Must be done before lseeking back
-    // to the header in the next step.  I believe this writes
-    // the CRC32 and ISIZE fields at the end of the file.
-    //
-    gzclose( (gzFile)m_gzfile );
+    for (size_t i=p; i < p + c.numProperties; i++)
+    {
+        stride += m_properties[i].width * dataSize(m_properties[i].type);
+    }
 
-    //
-    // Write the raw offset to the index table into the
-    // 'extra' gzip header field.
-    //
-#ifdef _WIN32
-    _lseek(m_gzRawFd, 12L, SEEK_SET);
-    ::_write(m_gzRawFd, &indexTableOffset, sizeof(unsigned int));
-    ::_write(m_gzRawFd, &indexTableSize, sizeof(unsigned int));
-#else
-    lseek(m_gzRawFd, 12L, SEEK_SET);
-    ::write(m_gzRawFd, &indexTableOffset, sizeof(unsigned int));
-    ::write(m_gzRawFd, &indexTableSize, sizeof(unsigned int));
-#endif
+    if (m_type == TextGTO)
+    {
+        //
+        //  Text files don't interleave
+        //
+
+        const char* src = (const char*)data;
+
+        for (size_t i=p, column=0; i < p + c.numProperties; i++)
+        {
+            size_t es = m_properties[i].width * dataSize(m_properties[i].type);
+            std::vector<char> buffer(es * count);
+
+            for (size_t q=0; q < count && src; q++)
+            {
+                memcpy(&buffer[q * es], src + q * stride + column, es);
+            }
 
+            propertyDataRaw(buffer.empty() ? 0 : &buffer.front());
+            column += es;
+        }
+    }
+    else
+    {
+#ifdef GTO_SUPPORT_ZIP
+        if (m_blocks && !m_blocks->startBlock()) m_error = true;
 #endif
-}
+        bool quantized = false;
 
+        for (size_t i=p; i < p + c.numProperties; i++)
+        {
+            if (quantizationBits(m_properties[i]) >= 0) quantized = true;
+        }
+
+        if (data && quantized)
+        {
+            //
+            //  Quantize the float columns of a copy of the records,
+            //  one column at a time so the values are aligned
+            //
+
+            m_transposeBuffer.resize(stride * count);
+            char* records = &m_transposeBuffer.front();
+            memcpy(records, data, stride * count);
+
+            for (size_t i=p, column=0; i < p + c.numProperties; i++)
+            {
+                const PropertyHeader& info = m_properties[i];
+                size_t es = info.width * dataSize(info.type);
+                int bits  = quantizationBits(info);
+
+                if (bits >= 0 && count)
+                {
+                    std::vector<char> values(es * count);
+                    size_t n = size_t(count) * info.width;
+
+                    for (size_t q=0; q < count; q++)
+                    {
+                        memcpy(&values[q * es], records + q * stride + column, es);
+                    }
+
+                    if (info.type == Float) quantizeFloats((float32*)&values.front(), n, bits);
+                    if (info.type == Double) quantizeDoubles((float64*)&values.front(), n, bits);
+
+                    for (size_t q=0; q < count; q++)
+                    {
+                        memcpy(records + q * stride + column, &values[q * es], es);
+                    }
+                }
+
+                column += es;
+            }
+
+            write(records, stride * count);
+            m_transposeBuffer.clear();
+        }
+        else if (data) write(data, stride * count);
+        else
+        {
+            std::vector<char> zeros(stride * count);
+            if (!zeros.empty()) write(&zeros.front(), zeros.size());
+        }
+
+        m_currentProperty += c.numProperties;
+    }
+}
 
 } // Gto
 
@@ -43,6 +43,8 @@
 #include <Gto/Utilities.h>
 #include <assert.h>
 #include <iostream>
+#include <algorithm>
+#include <iterator>
 #include <map>
 #include <string>
 #include <vector>
@@ -50,6 +52,9 @@
 
 namespace Gto {
 
+class BlockWriter;
+class SharedStringTable;
+
 //
 //  class Gto::Writer
 //
@@ -74,13 +79,34 @@ public:
     typedef std::vector<PropertyHeader>     Properties;
     typedef std::vector<ObjectHeader>       Objects;
     typedef std::map<size_t, PropertyPath>  PropertyMap;
-    typedef std::vector<unsigned int>       DataOffsets;
+    typedef std::vector<uint64>             DataOffsets;
+
+    //
+    //  One piece of a property's data for propertyDataSpans()
+    //
+
+    struct GTO_API Span
+    {
+        Span(const void* d=0, size_t b=0) : data(d), bytes(b) {}
+        const void* data;
+        size_t      bytes;
+    };
+
+    //
+    //  CompressedGTO is gzip. LZ4CompressedGTO (fast) and
+    //  ZstdCompressedGTO (small) need the library to be built with
+    //  GTO_SUPPORT_LZ4 / GTO_SUPPORT_ZSTD; open() fails for them
+    //  otherwise (see supports()). Readers detect the codec
+    //  themselves.
+    //
 
     enum FileType
     {
         BinaryGTO,
         CompressedGTO,
-        TextGTO
+        TextGTO,
+        LZ4CompressedGTO,
+        ZstdCompressedGTO
     };
 
     Writer();
@@ -94,6 +120,14 @@ public:
     bool            open(const char* filename,
                          FileType mode = BinaryGTO,
                          bool writeIndex=true);
+
+    //
+    //  True if this build of the library can write the file type.
+    //  CompressedGTO without zlib is written as BinaryGTO and
+    //  reports false.
+    //
+
+    static bool     supports(FileType);
     
     //
     //  Deprecated open API
@@ -102,6 +136,55 @@ public:
     bool            open(const char* f, bool c) 
                     { return open(f, c ? CompressedGTO : BinaryGTO); }
 
+    //
+    //  Number of threads used to compress a block compressed file
+    //  (indexed CompressedGTO, LZ4 or Zstd). 0 (the default) means
+    //  one per core, 1 compresses on the calling thread. The file
+    //  contents don't depend on it. Must be called before beginData().
+    //
+
+    void            setCompressionThreads(unsigned int n) 
+                    { m_compressionThreads = n; }
+
+    //
+    //  Lossy: float and double properties with the given
+    //  interpretation have their mantissa rounded to mantissaBits
+    //  bits when written (e.g. 10 for normals or colors). The data
+    //  is still ordinary floats to a reader. A negative value
+    //  removes the setting.
+    //
+
+    void            setQuantization(const char* interpretation,
+                                    int mantissaBits);
+
+    //
+    //  Streaming: call before declaring anything. Each property's data
+    //  can then be given as soon as the property is declared (still in
+    //  declaration order) and is written out right away; endData()
+    //  writes the description after the data. Only the description is
+    //  held in memory. The data of a Transposed component's properties
+    //  can only be given after its endComponent().
+    //
+    //  String ids are assigned as strings are interned, so intern the
+    //  strings a string property uses before giving its data and use
+    //  lookup() for their ids. Readers find the description
+    //  themselves but need to seek to the end of the file, so
+    //  compressed files are always written with an index.
+    //
+
+    void            setStreaming(bool s) { m_streaming = s; }
+    bool            isStreaming() const { return m_streaming; }
+
+    //
+    //  Use a finished SharedStringTable for the strings most files
+    //  have in common: they get the table's ids and aren't sorted or
+    //  stored again, only the strings it doesn't have are. Set it
+    //  before declaring anything; it can't be combined with
+    //  beginData()'s ordered strings. The table is not copied.
+    //
+
+    void            setSharedStringTable(const SharedStringTable*);
+
     //
     //  Close stream if applicable.
     //
@@ -132,14 +215,23 @@ public:
                                    unsigned int flags=0);
 
     //
-    //  delcare a property of a component
+    //  A component declared with the Transposed flag stores its
+    //  properties interleaved (element 0 of every property, then
+    //  element 1, ...). All its properties must have the same number
+    //  of elements and filters are ignored. Its data can be given
+    //  per property as usual or in one go with componentDataRaw().
+    //
+    //  delcare a property of a component. filters is a combination of
+    //  PropertyFilter bits; they usually make the data compress
+    //  better and are undone by the reader.
     //
 
     void            property(const char* name,
                              Gto::DataType,
                              size_t numElements,
                              size_t width=1,
-                             const char* interp=0);
+                             const char* interp=0,
+                             unsigned int filters=0);
 
     void            endComponent();
 
@@ -194,6 +286,16 @@ public:
 
     void            emptyProperty() { propertyDataRaw((void*)0); }
 
+    //
+    //  Data for all the properties of a Transposed component,
+    //  already interleaved. Call it in place of the component's
+    //  propertyData..() calls. Quantization applies as it does to
+    //  the per property calls.
+    //
+
+    void            componentDataRaw(const void* data,
+                                     const char* componentName=0);
+
     template<typename T>
     void            propertyData(const T *data, 
                                  const char *propertyName=0,
@@ -206,12 +308,53 @@ public:
                                  int size=0, 
                                  int width=0);
 
+    //
+    //  Gathering versions of propertyDataRaw(). The data is written
+    //  straight from the caller's memory when the property is plain
+    //  binary data; filtered, quantized, transposed and text output
+    //  still collect it into one buffer first.
+    //
+    //  propertyDataSpans() takes the data in pieces which together
+    //  must hold exactly the property's bytes. Small pieces are packed
+    //  into a 64K staging buffer so they reach the file in a few large
+    //  writes; pieces of 64K or more are written directly.
+    //  propertyDataStrided() takes element i at data + i * strideBytes
+    //  (e.g. one field of an array of structs). propertyDataRange()
+    //  takes the values from a pair of forward iterators, passed
+    //  through a small chunk buffer rather than a copy of the whole
+    //  range.
+    //
+
+    void            propertyDataSpans(const Span* spans,
+                                      size_t numSpans,
+                                      const char *propertyName=0,
+                                      int size=0, 
+                                      int width=0);
+
+    void            propertyDataStrided(const void* data,
+                                        size_t strideBytes,
+                                        const char *propertyName=0,
+                                        int size=0, 
+                                        int width=0);
+
+    template<class Iter>
+    void            propertyDataRange(Iter begin, Iter end,
+                                      const char *propertyName=0,
+                                      int size=0, 
+                                      int width=0);
+
     template<class T>
     void            propertyDataInContainer(const T &container,
                                             const char *propertyName=0,
                                             int size=0, 
                                             int width=0);
 
+    template<class T>
+    void            propertyDataInContainer(const std::vector<T> &container,
+                                            const char *propertyName=0,
+                                            int size=0, 
+                                            int width=0);
+
     void            endData();
 
     //
@@ -231,25 +374,38 @@ private:
     void            writeText(const std::string&);
     void            writeQuotedString(const std::string&);
     void            writeMaybeQuotedString(const std::string&);
+    void            writeTextValues(const PropertyHeader&, const char*, size_t);
     void            flush();
 
-    void            prepIndexTable();
-    void            writeIndexTable();
-
     bool            propertySanityCheck(const char*, int, int);
+    void            writeTransposed(size_t first, size_t last);
+    uint32          declareName(const char*);
+    int             streamString(const std::string&);
+    int             stringId(const std::string&) const;
+    void            writeStreamDescription();
+    bool            canWriteDirect(size_t bytes) const;
+    int             quantizationBits(const PropertyHeader&) const;
+    bool            beginDirectWrite(const char*, int, int);
 
 private:
     std::ostream*   m_out;
     void*           m_gzfile;
     int             m_gzRawFd;
+    BlockWriter*    m_blocks;
     Objects         m_objects;
     Components      m_components;
     Properties      m_properties;
     PropertyMap     m_propertyMap;
     StringVector    m_names;
     StringMap       m_strings;
+    StringMap       m_quantize;
+    std::vector<char> m_filterBuffer;
+    std::vector<char> m_transposeBuffer;
+    std::vector<char> m_textBuffer;
+    std::vector<size_t> m_propertyComponents;
     std::string     m_outName;
     size_t          m_currentProperty;
+    unsigned int    m_compressionThreads;
     FileType        m_type;
     bool            m_needsClosing      : 1;
     bool            m_error             : 1;
@@ -259,8 +415,9 @@ private:
     bool            m_objectActive      : 1;
     bool            m_componentActive   : 1;
     bool            m_writeIndexTable   : 1;
-    // size_t          m_bytesWritten;
-    DataOffsets     m_dataOffsets;
+    bool            m_streaming         : 1;
+    uint64          m_bytesWritten;
+    const SharedStringTable* m_sharedStrings;
 };
 
 template<typename T>
@@ -295,12 +452,59 @@ void Writer::propertyDataInContainer(const T &container,
                                      int size, 
                                      int width)
 {
-    typedef typename T::value_type value_type;
-    // typedef typename T::const_iterator iterator;
+    propertyDataRange(container.begin(), container.end(), 
+                      propertyName, size, width);
+}
+
+template<class T>
+void Writer::propertyDataInContainer(const std::vector<T> &container,
+                                     const char *propertyName, 
+                                     int size, 
+                                     int width)
+{
+    //
+    //  Already contiguous
+    //
+
+    propertyDataRaw(container.empty() ? 0 : &container.front(), 
+                    propertyName, size, width);
+}
+
+template<class Iter>
+void Writer::propertyDataRange(Iter begin, Iter end,
+                               const char *propertyName, 
+                               int size, 
+                               int width)
+{
+    typedef typename std::iterator_traits<Iter>::value_type value_type;
+    size_t n = size_t(std::distance(begin, end));
+
+    if (!canWriteDirect(n * sizeof(value_type)))
+    {
+        std::vector<value_type> data(begin, end);
+        propertyDataRaw(data.empty() ? 0 : &data.front(), 
+                        propertyName, size, width);
+        return;
+    }
+
+    if (!beginDirectWrite(propertyName, size, width)) return;
+
+    std::vector<value_type> chunk;
+    size_t chunkSize = std::max(size_t(1), (64 * 1024) / sizeof(value_type));
+    chunk.reserve(chunkSize);
+
+    for (; begin != end; ++begin)
+    {
+        chunk.push_back(*begin);
+
+        if (chunk.size() == chunkSize)
+        {
+            write(&chunk.front(), chunkSize * sizeof(value_type));
+            chunk.clear();
+        }
+    }
 
-    std::vector<value_type> data(container.size());
-    std::copy(container.begin(), container.end(), data.begin());
-    propertyDataRaw(&data.front(), propertyName, size, width);
+    if (!chunk.empty()) write(&chunk.front(), chunk.size() * sizeof(value_type));
 }
 
 } // Gto
@@ -35,10 +35,23 @@
 //
 #include <Gto/Writer.h>
 #include <Gto/Reader.h>
+#include <Gto/SequenceReader.h>
+#include <Gto/SharedStringTable.h>
+#include <Gto/Parallel.h>
+#include <Gto/Utilities.h>
 #include <iostream>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 using namespace std;
@@ -46,26 +59,84 @@ using namespace std;
 float fdata[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
 int   idata[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
 
-void write(const char *filename)
+//
+//  Reads every property and compares it against fdata/idata
+//
+
+class CheckReader : public Gto::Reader
 {
-    cout << "writing " << filename << endl;
+public:
+    CheckReader(unsigned int mode = None) 
+        : Gto::Reader(mode), numRead(0), numMapped(0), numBad(0) {}
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        vector<char>& buffer = m_buffers[&info];
+        buffer.resize(bytes);
+        return bytes ? &buffer.front() : 0;
+    }
+
+    virtual bool dataMapped(const PropertyInfo& info, const void* p, size_t bytes)
+    {
+        vector<char>& buffer = m_buffers[&info];
+        buffer.resize(bytes);
+        memcpy(&buffer.front(), p, bytes);
+        numMapped++;
+        return true;
+    }
+
+    virtual void dataRead(const PropertyInfo& info)
+    {
+        const void* expected = info.type == Gto::Float ? (void*)fdata : (void*)idata;
+        const vector<char>& buffer = m_buffers[&info];
+        if (buffer.size() != sizeof(fdata) ||
+            memcmp(&buffer.front(), expected, sizeof(fdata))) numBad++;
+        numRead++;
+    }
+
+    int numRead;
+    int numMapped;
+    int numBad;
+
+private:
+    map<const PropertyInfo*, vector<char> > m_buffers;
+};
+
+void write(const char *filename, 
+           Gto::Writer::FileType type = Gto::Writer::BinaryGTO,
+           bool index = true,
+           unsigned int threads = 1,
+           unsigned int filters = 0,
+           bool transposed = false,
+           const Gto::SharedStringTable* shared = 0)
+{
+    if (!shared) cout << "writing " << filename << endl;
     Gto::Writer writer;
-    writer.open(filename);
+    writer.setCompressionThreads(threads);
+    writer.open(filename, type, index);
+
+    if (shared)
+    {
+        writer.setSharedStringTable(shared);
+        writer.intern(filename);
+    }
+
+    unsigned int flags = transposed ? Gto::Transposed : 0;
 
     writer.beginObject("test", "data", 0);
-        writer.beginComponent("component_1");
-            writer.property("property_1", Gto::Float, 10);
-            writer.property("property_2", Gto::Float, 10);
-            writer.property("property_3", Gto::Int, 10);
+        writer.beginComponent("component_1", flags);
+            writer.property("property_1", Gto::Float, 10, 1, 0, filters);
+            writer.property("property_2", Gto::Float, 10, 1, 0, filters);
+            writer.property("property_3", Gto::Int, 10, 1, 0, filters);
         writer.endComponent();
     writer.endObject();
 
     writer.beginObject("test2", "data", 0);
-        writer.beginComponent("component_1");
-            writer.property("property_1", Gto::Float, 10);
-            writer.property("property_2", Gto::Float, 10);
-            writer.property("property_3", Gto::Int, 10);
-            writer.property("property_4", Gto::Int, 10);
+        writer.beginComponent("component_1", flags);
+            writer.property("property_1", Gto::Float, 10, 1, 0, filters);
+            writer.property("property_2", Gto::Float, 10, 1, 0, filters);
+            writer.property("property_3", Gto::Int, 10, 1, 0, filters);
+            writer.property("property_4", Gto::Int, 10, 1, 0, filters);
         writer.endComponent();
     writer.endObject();
 
@@ -74,10 +145,122 @@ void write(const char *filename)
         writer.propertyData(fdata);
         writer.propertyData(idata);
 
-        writer.propertyData(fdata);
-        writer.propertyData(fdata);
-        writer.propertyData(idata);
-        writer.propertyData(idata);
+        if (transposed)
+        {
+            struct { float f1, f2; int i3, i4; } records[10];
+
+            for (int i=0; i < 10; i++)
+            {
+                records[i].f1 = records[i].f2 = fdata[i];
+                records[i].i3 = records[i].i4 = idata[i];
+            }
+
+            writer.componentDataRaw(records, "component_1");
+        }
+        else
+        {
+            writer.propertyData(fdata);
+            writer.propertyData(fdata);
+            writer.propertyData(idata);
+            writer.propertyData(idata);
+        }
+    writer.endData();
+}
+
+void writeStreamed(const char *filename, 
+                   Gto::Writer::FileType type = Gto::Writer::BinaryGTO)
+{
+    cout << "writing streamed " << filename << endl;
+    Gto::Writer writer;
+    writer.open(filename, type);
+    writer.setStreaming(true);
+
+    //
+    //  Data right after each declaration, then a transposed component
+    //  given whole after endComponent()
+    //
+
+    unsigned int filters = Gto::ShuffleFilter | Gto::DeltaFilter;
+
+    writer.beginObject("test", "data", 0);
+        writer.beginComponent("component_1");
+            writer.property("property_1", Gto::Float, 10, 1, 0, filters);
+            writer.propertyData(fdata);
+            writer.property("property_2", Gto::Float, 10, 1, 0, filters);
+            writer.propertyData(fdata);
+            writer.property("property_3", Gto::Int, 10, 1, 0, filters);
+            writer.propertyData(idata);
+        writer.endComponent();
+    writer.endObject();
+
+    writer.beginObject("test2", "data", 0);
+        writer.beginComponent("component_1", Gto::Transposed);
+            writer.property("property_1", Gto::Float, 10, 1);
+            writer.property("property_2", Gto::Float, 10, 1);
+            writer.property("property_3", Gto::Int, 10, 1);
+            writer.property("property_4", Gto::Int, 10, 1);
+        writer.endComponent();
+
+        struct { float f1, f2; int i3, i4; } records[10];
+
+        for (int i=0; i < 10; i++)
+        {
+            records[i].f1 = records[i].f2 = fdata[i];
+            records[i].i3 = records[i].i4 = idata[i];
+        }
+
+        writer.componentDataRaw(records, "component_1");
+    writer.endObject();
+
+    writer.endData();
+}
+
+void writeGathered(const char *filename, 
+                   Gto::Writer::FileType type = Gto::Writer::BinaryGTO,
+                   unsigned int filters = 0)
+{
+    cout << "writing gathered " << filename << endl;
+    Gto::Writer writer;
+    writer.open(filename, type);
+
+    writer.beginObject("test", "data", 0);
+        writer.beginComponent("component_1");
+            writer.property("property_1", Gto::Float, 10, 1, 0, filters);
+            writer.property("property_2", Gto::Float, 10, 1, 0, filters);
+            writer.property("property_3", Gto::Int, 10, 1, 0, filters);
+        writer.endComponent();
+    writer.endObject();
+
+    writer.beginObject("test2", "data", 0);
+        writer.beginComponent("component_1");
+            writer.property("property_1", Gto::Float, 10, 1, 0, filters);
+            writer.property("property_2", Gto::Float, 10, 1, 0, filters);
+            writer.property("property_3", Gto::Int, 10, 1, 0, filters);
+            writer.property("property_4", Gto::Int, 10, 1, 0, filters);
+        writer.endComponent();
+    writer.endObject();
+
+    struct { float f; int i; } records[10];
+
+    for (int i=0; i < 10; i++)
+    {
+        records[i].f = fdata[i];
+        records[i].i = idata[i];
+    }
+
+    Gto::Writer::Span spans[2] = { Gto::Writer::Span(fdata, 3 * sizeof(float)),
+                                   Gto::Writer::Span(fdata + 3, 7 * sizeof(float)) };
+    list<int> ilist(idata, idata + 10);
+    deque<float> fdeque(fdata, fdata + 10);
+
+    writer.beginData();
+        writer.propertyDataSpans(spans, 2, "property_1");
+        writer.propertyDataStrided(&records[0].f, sizeof(records[0]), "property_2");
+        writer.propertyDataRange(ilist.begin(), ilist.end(), "property_3");
+        writer.propertyDataInContainer(fdeque, "property_1");
+        writer.propertyDataSpans(spans, 2, "property_2");
+        writer.propertyDataStrided(&records[0].i, sizeof(records[0]), "property_3");
+        writer.propertyDataInContainer(ilist, "property_4");
     writer.endData();
 }
 
@@ -88,13 +271,930 @@ void read(const char *filename)
     reader.open(filename);
 }
 
+bool check(const char *filename, unsigned int mode, bool mapped, 
+           unsigned int threads = 0)
+{
+    cout << "checking " << filename << " (mode " << mode << ")" << endl;
+    CheckReader reader(mode);
+
+    if (!reader.open(filename))
+    {
+        cerr << "failed to open " << filename << ": " << reader.why() << endl;
+        return false;
+    }
+
+    if ((mode & Gto::Reader::RandomAccess) && threads)
+    {
+        vector<Gto::Reader::ObjectInfo*> objects;
+
+        for (size_t i=0; i < reader.objects().size(); i++)
+        {
+            objects.push_back(&reader.objects()[i]);
+        }
+
+        reader.accessObjects(objects, threads);
+    }
+    else if (mode & Gto::Reader::RandomAccess)
+    {
+        for (size_t i=0; i < reader.objects().size(); i++)
+        {
+            reader.accessObject(reader.objects()[i]);
+        }
+    }
+
+    if (strstr(filename, ".gz") && 
+        reader.hasIndex() != ((mode & Gto::Reader::RandomAccess) != 0))
+    {
+        cerr << "unexpected index state for " << filename << endl;
+        return false;
+    }
+
+    return reader.numRead == 7 && reader.numBad == 0 &&
+           (reader.numMapped == 7) == mapped;
+}
+
+bool checkSequence()
+{
+    cout << "checking sequence" << endl;
+    char name[64];
+
+    for (int f=1; f <= 5; f++)
+    {
+        sprintf(name, "test.%04d.gto", f);
+        write(name);
+    }
+
+    bool ok = true;
+
+    {
+        Gto::SequenceReader sequence("test.%04d.gto", Gto::Reader::None, 2, 2);
+
+        for (int f=1; f <= 5; f++)
+        {
+            const Gto::RawDataBase* db = sequence.frame(f);
+            ok = ok && db && db->objects.size() == 2;
+        }
+
+        ok = ok && sequence.frame(6) == 0 && sequence.frame(3) != 0;
+    }
+
+    for (int f=1; f <= 5; f++)
+    {
+        sprintf(name, "test.%04d.gto", f);
+        unlink(name);
+    }
+
+    return ok;
+}
+
+bool checkArena(const char *filename)
+{
+    cout << "checking arena " << filename << endl;
+    Gto::RawDataBaseReader reader(Gto::Reader::None, true);
+    if (!reader.open(filename)) return false;
+
+    const Gto::RawDataBase* db = reader.dataBase();
+    if (db->arenas.size() != 1 || db->arenas[0]->numSlabs() != 1) return false;
+
+    const Gto::Properties& props = db->objects[1]->components[0]->properties;
+
+    for (size_t i=0; i < props.size(); i++)
+    {
+        const Gto::Property* p = props[i];
+        if (p->_allocated || (size_t(p->voidData) & 15)) return false;
+
+        for (size_t q=0; q < 10; q++)
+        {
+            if (p->type == Gto::Float ? p->floatData[q] != fdata[q] 
+                                      : p->int32Data[q] != idata[q])
+            {
+                return false;
+            }
+        }
+    }
+
+    return props.size() == 4;
+}
+
+bool checkConcurrent(const char *filename)
+{
+    cout << "checking concurrent and partial reads of " << filename << endl;
+    Gto::Reader reader(Gto::Reader::RandomAccess);
+    if (!reader.open(filename) || !reader.openConcurrentAccess()) return false;
+
+    const Gto::Reader::Properties& props = reader.properties();
+    vector<int> bad(4, 0);
+    vector<thread> threads;
+
+    for (size_t t=0; t < bad.size(); t++)
+    {
+        threads.push_back(thread([&, t]() {
+            for (int pass=0; pass < 50; pass++)
+            {
+                for (size_t i=0; i < props.size(); i++)
+                {
+                    const void* expected = props[i].type == Gto::Float 
+                        ? (const void*)fdata : (const void*)idata;
+                    char buffer[sizeof(fdata)];
+
+                    if (!reader.readPropertyData(props[i], buffer) ||
+                        memcmp(buffer, expected, sizeof(fdata))) bad[t]++;
+                }
+            }
+        }));
+    }
+
+    for (size_t t=0; t < threads.size(); t++) threads[t].join();
+    for (size_t t=0; t < bad.size(); t++) if (bad[t]) return false;
+
+    //
+    //  Element ranges: [2, 9) every third element and [4, 6)
+    //
+
+    for (size_t i=0; i < props.size(); i++)
+    {
+        int values[3];
+        bool isFloat = props[i].type == Gto::Float;
+
+        if (!reader.readPropertyData(props[i], values, 2, 9, 3) ||
+            (isFloat ? ((float*)values)[0] != 3 || ((float*)values)[2] != 9
+                     : values[0] != 3 || values[1] != 6 || values[2] != 9) ||
+            !reader.readPropertyData(props[i], values, 4, 6) ||
+            (isFloat ? ((float*)values)[1] != 6 : values[1] != 6) ||
+            reader.readPropertyData(props[i], values, 4, 11))
+        {
+            return false;
+        }
+    }
+
+    return props.size() == 7;
+}
+
+bool checkTransposedQuantization()
+{
+    cout << "checking quantized transposed components" << endl;
+
+    //
+    //  The same records given per property and in one go must come
+    //  out the same, and quantized
+    //
+
+    struct { float f; int i; double d; } records[10];
+    float  f[10];
+    int    i[10];
+    double d[10];
+
+    for (int q=0; q < 10; q++)
+    {
+        records[q].f = f[q] = 1.0f / (q + 3);
+        records[q].i = i[q] = q;
+        records[q].d = d[q] = 1.0 / (q + 7);
+    }
+
+    string bytes[2];
+
+    for (int n=0; n < 2; n++)
+    {
+        Gto::Writer writer;
+        writer.setQuantization("q", 10);
+        writer.open("quantized.gto", Gto::Writer::BinaryGTO);
+        writer.beginObject("test", "data", 0);
+            writer.beginComponent("records", Gto::Transposed);
+                writer.property("f", Gto::Float, 10, 1, "q");
+                writer.property("i", Gto::Int, 10, 1);
+                writer.property("d", Gto::Double, 10, 1, "q");
+            writer.endComponent();
+        writer.endObject();
+        writer.beginData();
+
+        if (n)
+        {
+            writer.componentDataRaw(records, "records");
+        }
+        else
+        {
+            writer.propertyData(f);
+            writer.propertyData(i);
+            writer.propertyData(d);
+        }
+
+        writer.endData();
+        writer.close();
+
+        ifstream in("quantized.gto", ios::binary);
+        ostringstream out;
+        out << in.rdbuf();
+        bytes[n] = out.str();
+    }
+
+    Gto::RawDataBaseReader reader;
+    bool ok = reader.open("quantized.gto");
+    unlink("quantized.gto");
+    if (!ok || bytes[0] != bytes[1]) return false;
+
+    const Gto::Properties& props = 
+        reader.dataBase()->objects[0]->components[0]->properties;
+
+    return props.size() == 3 && 
+           props[0]->floatData[0] != f[0] &&
+           props[1]->int32Data[9] == 9 &&
+           props[2]->doubleData[0] != d[0];
+}
+
+#ifdef GTO_SUPPORT_ZIP
+bool checkCompressedRanges()
+{
+    cout << "checking ranges of a block compressed file" << endl;
+
+    //
+    //  Several blocks, with the float data starting off the block
+    //  boundaries, read contiguously, strided through and sparsely
+    //
+
+    const size_t n = 600000;
+    vector<float> values(n);
+    for (size_t i=0; i < n; i++) values[i] = float(i);
+    unsigned char bytes[3] = { 1, 2, 3 };
+
+    Gto::Writer writer;
+    writer.open("ranges.gto.gz", Gto::Writer::CompressedGTO);
+    writer.beginObject("test", "data", 0);
+        writer.beginComponent("values");
+            writer.property("b", Gto::Byte, 1, 3);
+            writer.property("f", Gto::Float, n, 1);
+            writer.property("d", Gto::Float, n, 1, 0, Gto::DeltaFilter);
+        writer.endComponent();
+    writer.endObject();
+    writer.beginData();
+        writer.propertyData(bytes);
+        writer.propertyData(&values.front());
+        writer.propertyData(&values.front());
+    writer.endData();
+    writer.close();
+
+    Gto::Reader reader(Gto::Reader::RandomAccess);
+    bool ok = reader.open("ranges.gto.gz") && reader.hasIndex();
+    unlink("ranges.gto.gz");
+    if (!ok) return false;
+
+    const Gto::Reader::Properties& props = reader.properties();
+    size_t strides[] = { 1, 1001, 3000 };
+
+    for (size_t p=1; p < 3; p++)
+    {
+        for (size_t s=0; s < 3; s++)
+        {
+            size_t begin = 100001, end = 500000, stride = strides[s];
+            vector<float> out((end - begin + stride - 1) / stride);
+
+            if (!reader.readPropertyData(props[p], &out.front(), 
+                                         begin, end, stride))
+            {
+                return false;
+            }
+
+            for (size_t i=0; i < out.size(); i++)
+            {
+                if (out[i] != values[begin + i * stride]) return false;
+            }
+        }
+    }
+
+    return true;
+}
+#endif
+
+bool checkParallelFor()
+{
+    cout << "checking exceptions from parallelFor" << endl;
+
+    std::atomic<size_t> done(0);
+
+    auto f = [&done](size_t i) {
+        if (i == 37) throw runtime_error("item 37");
+        done++;
+    };
+
+    try
+    {
+        Gto::parallelFor(1000, 4, f);
+    }
+    catch (runtime_error& e)
+    {
+        return string(e.what()) == "item 37" && done < 1000;
+    }
+
+    return false;
+}
+
+//
+//  The vectorized swap kernels against a plain byte reversal, for
+//  every element width, lengths either side of the vector sizes and
+//  buffers starting at every offset within a 32 byte line
+//
+
+bool checkSwapKernels()
+{
+    cout << "checking swap kernels" << endl;
+
+    typedef void (*SwapFunc)(void*, size_t);
+    const SwapFunc funcs[]  = { Gto::swapShorts, Gto::swapWords, Gto::swapDoubleWords };
+    const size_t   widths[] = { 2, 4, 8 };
+    const size_t   sizes[]  = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33,
+                                63, 64, 65, 100, 1000, 1031 };
+
+    vector<unsigned char> buffer(1031 * 8 + 64);
+    vector<unsigned char> expected(buffer.size());
+
+    for (size_t f=0; f < 3; f++)
+    {
+        const size_t w = widths[f];
+
+        for (size_t s=0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+        {
+            for (size_t offset=0; offset < 32; offset++)
+            {
+                const size_t n = sizes[s];
+
+                for (size_t i=0; i < buffer.size(); i++)
+                {
+                    buffer[i] = expected[i] = (unsigned char)(i * 7 + offset);
+                }
+
+                for (size_t i=0; i < n; i++)
+                {
+                    unsigned char* e = &expected[offset + i * w];
+                    reverse(e, e + w);
+                }
+
+                funcs[f](&buffer[offset], n);
+
+                if (buffer != expected)
+                {
+                    cerr << "swap of " << n << " " << w << " byte values at offset "
+                         << offset << " is wrong" << endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+//
+//  Writes a file, converts it to the other byte order by hand and
+//  reads it back. Covers every swapped element width.
+//
+
+class SwappedReader : public Gto::Reader
+{
+public:
+    SwappedReader(unsigned int mode) : Gto::Reader(mode) {}
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        vector<char>& buffer = buffers[stringFromId(info.name)];
+        buffer.resize(bytes);
+        return bytes ? &buffer.front() : 0;
+    }
+
+    map<string, vector<char> > buffers;
+};
+
+bool checkSwappedFile()
+{
+    cout << "checking byte swapped file" << endl;
+
+    const size_t n = 37;
+    vector<double>       ddata(n);
+    vector<Gto::uint16>  sdata(n);
+    vector<float>        f3data(n * 3);
+    vector<int>          idata2(n);
+
+    for (size_t i=0; i < n; i++)
+    {
+        ddata[i]  = i * 1.25e10 + 0.5;
+        sdata[i]  = Gto::uint16(i * 1031);
+        idata2[i] = int(i * 0x01020304);
+        for (int j=0; j < 3; j++) f3data[i * 3 + j] = i * 0.5f - j;
+    }
+
+    {
+        Gto::Writer writer;
+        writer.open("swapped.gto", Gto::Writer::BinaryGTO, false);
+
+        writer.beginObject("swapped", "data", 1);
+            writer.beginComponent("values");
+                writer.property("double", Gto::Double, n, 1);
+                writer.property("short", Gto::Short, n, 1);
+                writer.property("float3", Gto::Float, n, 3);
+                writer.property("int", Gto::Int, n, 1);
+            writer.endComponent();
+        writer.endObject();
+
+        writer.beginData();
+            writer.propertyData(&ddata.front());
+            writer.propertyData(&sdata.front());
+            writer.propertyData(&f3data.front());
+            writer.propertyData(&idata2.front());
+        writer.endData();
+    }
+
+    vector<char> file;
+
+    {
+        ifstream in("swapped.gto", ios::binary);
+        file.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    //
+    //  Header, string table, object, component and property headers,
+    //  then the data in property order
+    //
+
+    char* p = &file.front();
+    Gto::Header header;
+    memcpy(&header, p, sizeof(header));
+    Gto::swapWords(p, sizeof(Gto::Header) / 4);
+    p += sizeof(Gto::Header);
+
+    for (size_t i=0; i < header.numStrings; i++) p += strlen(p) + 1;
+
+    size_t numComponents = 0;
+
+    for (size_t i=0; i < header.numObjects; i++, p += sizeof(Gto::ObjectHeader))
+    {
+        Gto::ObjectHeader o;
+        memcpy(&o, p, sizeof(o));
+        numComponents += o.numComponents;
+        Gto::swapWords(p, sizeof(Gto::ObjectHeader) / 4);
+    }
+
+    size_t numProperties = 0;
+
+    for (size_t i=0; i < numComponents; i++, p += sizeof(Gto::ComponentHeader))
+    {
+        Gto::ComponentHeader c;
+        memcpy(&c, p, sizeof(c));
+        numProperties += c.numProperties;
+        Gto::swapWords(p, sizeof(Gto::ComponentHeader) / 4);
+    }
+
+    vector<Gto::PropertyHeader> properties(numProperties);
+
+    for (size_t i=0; i < numProperties; i++, p += sizeof(Gto::PropertyHeader))
+    {
+        memcpy(&properties[i], p, sizeof(Gto::PropertyHeader));
+        Gto::swapWords(p, sizeof(Gto::PropertyHeader) / 4);
+    }
+
+    for (size_t i=0; i < numProperties; i++)
+    {
+        const Gto::PropertyHeader& h = properties[i];
+        size_t count = h.size * h.width;
+
+        switch (Gto::dataSize(h.type))
+        {
+          case 2: Gto::swapShorts(p, count); break;
+          case 4: Gto::swapWords(p, count); break;
+          case 8: Gto::swapDoubleWords(p, count); break;
+        }
+
+        p += count * Gto::dataSize(h.type);
+    }
+
+    {
+        ofstream out("swapped.gto", ios::binary);
+        out.write(&file.front(), file.size());
+    }
+
+    const unsigned int modes[] = { Gto::Reader::None,
+                                   Gto::Reader::MemoryMapped,
+                                   Gto::Reader::RandomAccess };
+    bool ok = p == &file.front() + file.size();
+
+    for (size_t m=0; ok && m < 3; m++)
+    {
+        SwappedReader reader(modes[m]);
+
+        if (!reader.open("swapped.gto"))
+        {
+            cerr << "failed to open swapped.gto: " << reader.why() << endl;
+            ok = false;
+            break;
+        }
+
+        if (modes[m] & Gto::Reader::RandomAccess)
+        {
+            reader.accessObject(reader.objects()[0]);
+        }
+
+        ok = reader.isSwapped() &&
+             reader.buffers["double"].size() == n * 8 &&
+             !memcmp(&reader.buffers["double"].front(), &ddata.front(), n * 8) &&
+             reader.buffers["short"].size() == n * 2 &&
+             !memcmp(&reader.buffers["short"].front(), &sdata.front(), n * 2) &&
+             reader.buffers["float3"].size() == n * 12 &&
+             !memcmp(&reader.buffers["float3"].front(), &f3data.front(), n * 12) &&
+             reader.buffers["int"].size() == n * 4 &&
+             !memcmp(&reader.buffers["int"].front(), &idata2.front(), n * 4);
+
+        if (!ok) cerr << "swapped.gto read back wrong (mode " << modes[m] << ")" << endl;
+    }
+
+    unlink("swapped.gto");
+    return ok;
+}
+
+bool checkSharedStrings()
+{
+    cout << "checking shared string table" << endl;
+
+    Gto::SharedStringTable table;
+    const char* names[] = { "test", "test2", "data", "component_1", "",
+                            "property_1", "property_2", "property_3", 
+                            "property_4", 0 };
+
+    for (const char** n = names; *n; n++) table.intern(*n);
+    table.finish();
+
+    //
+    //  Frames written at the same time from one table
+    //
+
+    const int numFiles = 4;
+    vector<thread> threads;
+    char filenames[numFiles][64];
+
+    for (int i=0; i < numFiles; i++)
+    {
+        sprintf(filenames[i], "test.shared.%d.gto", i);
+        const char* filename = filenames[i];
+
+        threads.push_back(thread([filename, &table]() {
+            write(filename, Gto::Writer::BinaryGTO, true, 1, 0, false, &table);
+        }));
+    }
+
+    for (int i=0; i < numFiles; i++) threads[i].join();
+
+    bool ok = true;
+
+    for (int i=0; i < numFiles; i++)
+    {
+        ok = check(filenames[i], Gto::Reader::None, false) && ok;
+
+        Gto::Reader reader;
+        ok = reader.open(filenames[i]) && ok;
+        const Gto::Reader::StringTable& strings = reader.stringTable();
+
+        for (size_t q=0; q < table.size() && ok; q++)
+        {
+            ok = strings[q] == table.strings()[q];
+        }
+
+        ok = ok && reader.findObject("test2") == 1 &&
+             find(strings.begin(), strings.end(), filenames[i]) != strings.end();
+
+        unlink(filenames[i]);
+    }
+
+    return ok;
+}
+
+bool checkTextParser()
+{
+    cout << "checking text parser" << endl;
+
+    istringstream in("GTOa (4)\n"
+                     "# comment\n"
+                     "obj : polygon (2)\n"
+                     "{\n"
+                     "    points as \"pAx\"\n"
+                     "    {\n"
+                     "        float[3][3] p = [ [ 1 2.5 -3 ] [ .5 1e2 -1.5E-3 ] ... ]\n"
+                     "        int[1][4] i = [ 0x1F 010 'a' '\\n' ]\n"
+                     "        string s = [ \"a\\tb\" plain \"\\101\\q\" ]\n"
+                     "        double d = -0.1\n"
+                     "    }\n"
+                     "}\n");
+
+    Gto::RawDataBaseReader reader;
+    if (!reader.open(in, "text", Gto::Reader::TextOnly)) return false;
+
+    const Gto::RawDataBase* db = reader.dataBase();
+    if (db->objects.size() != 1) return false;
+    const Gto::Object* o = db->objects[0];
+    if (o->protocol != "polygon" || o->protocolVersion != 2) return false;
+    const Gto::Component* c = o->components[0];
+    if (c->interp != "pAx" || c->properties.size() != 4) return false;
+
+    const Gto::Property* p = c->properties[0];
+    const float pdata[] = { 1, 2.5, -3, .5, 100, -1.5e-3f, .5, 100, -1.5e-3f };
+    if (p->size != 3 || memcmp(p->floatData, pdata, sizeof(pdata))) return false;
+
+    const Gto::Property* i = c->properties[1];
+    if (i->int32Data[0] != 31 || i->int32Data[1] != 8 || 
+        i->int32Data[2] != 'a' || i->int32Data[3] != '\n') return false;
+
+    const Gto::Property* t = c->properties[2];
+    if (t->size != 3 || t->stringData[0] != "a\tb" ||
+        t->stringData[1] != "plain" || t->stringData[2] != "A\\q") return false;
+
+    return c->properties[3]->doubleData[0] == -0.1;
+}
+
+bool checkTextNumbers()
+{
+    cout << "checking text numbers" << endl;
+
+    const float  f[] = { 0.1f, 1.f / 3.f, -1e-30f, 3.4028235e38f, 
+                         16777216.f, 123456789012.f, -0.5f, 0 };
+    const double d[] = { 0.1, 1.0 / 3.0, -2.5e-300, 123456789012.0 };
+    const int    i[] = { 0, -1, 2147483647, -2147483647 - 1 };
+    const short  h[] = { -32768, 32767 };
+
+    Gto::Writer writer;
+    writer.open("numbers.gto", Gto::Writer::TextGTO);
+    writer.beginObject("numbers", "data", 1);
+        writer.beginComponent("values");
+            writer.property("f", Gto::Float, 4, 2);
+            writer.property("d", Gto::Double, 4);
+            writer.property("i", Gto::Int, 4);
+            writer.property("h", Gto::Short, 2);
+        writer.endComponent();
+    writer.endObject();
+    writer.beginData();
+        writer.propertyData(f);
+        writer.propertyData(d);
+        writer.propertyData(i);
+        writer.propertyData(h);
+    writer.endData();
+    writer.close();
+
+    Gto::RawDataBaseReader reader;
+    bool ok = reader.open("numbers.gto");
+    unlink("numbers.gto");
+    if (!ok) return false;
+
+    const Gto::Properties& props = 
+        reader.dataBase()->objects[0]->components[0]->properties;
+
+    return props.size() == 4 && props[0]->size == 4 && 
+           !memcmp(props[0]->floatData, f, sizeof(f)) &&
+           !memcmp(props[1]->doubleData, d, sizeof(d)) &&
+           !memcmp(props[2]->int32Data, i, sizeof(i)) &&
+           !memcmp(props[3]->uint16Data, h, sizeof(h));
+}
+
+bool checkParallelText()
+{
+    cout << "checking parallel text" << endl;
+
+    //
+    //  Big enough that the numeric bodies are converted on the
+    //  worker threads
+    //
+
+    const size_t n = 30000;
+    vector<float> f(n * 3);
+    vector<int> i(n);
+    const char* s[] = { "one", "two" };
+
+    for (size_t q = 0; q < n; q++)
+    {
+        f[q * 3] = f[q * 3 + 1] = f[q * 3 + 2] = q / 7.0f;
+        i[q] = int(q) * 3 - 1000;
+    }
+
+    Gto::Writer writer;
+    writer.open("parallel.gto", Gto::Writer::TextGTO);
+    writer.beginObject("parallel", "data", 1);
+        writer.beginComponent("values");
+            writer.property("f", Gto::Float, n, 3);
+            writer.property("s", Gto::String, 2);
+            writer.property("i", Gto::Int, n);
+        writer.endComponent();
+    writer.endObject();
+    writer.intern(s[0]);
+    writer.intern(s[1]);
+    writer.beginData();
+        writer.propertyData(&f.front());
+        int sids[] = { writer.lookup(s[0]), writer.lookup(s[1]) };
+        writer.propertyData(sids);
+        writer.propertyData(&i.front());
+    writer.endData();
+    writer.close();
+
+    Gto::RawDataBaseReader reader(Gto::Reader::ParallelText);
+    bool ok = reader.open("parallel.gto");
+
+    if (ok)
+    {
+        const Gto::Properties& props = 
+            reader.dataBase()->objects[0]->components[0]->properties;
+
+        ok = props.size() == 3 && props[0]->size == n && props[2]->size == n &&
+             !memcmp(props[0]->floatData, &f.front(), f.size() * sizeof(float)) &&
+             props[1]->stringData[1] == "two" &&
+             !memcmp(props[2]->int32Data, &i.front(), i.size() * sizeof(int));
+    }
+
+    //
+    //  Errors in a deferred body still fail the read
+    //
+
+    FILE* file = fopen("parallel.gto", "a");
+    fprintf(file, "bad { c { int[1][%d] x = [ ", int(n));
+    for (size_t q = 0; q < n; q++) fprintf(file, "%d ", int(q));
+    fprintf(file, "e ] } }\n");
+    fclose(file);
+
+    Gto::RawDataBaseReader bad(Gto::Reader::ParallelText);
+    ok = !bad.open("parallel.gto") && ok;
+    unlink("parallel.gto");
+    return ok;
+}
+
+bool checkFind(const char *filename, unsigned int mode = Gto::Reader::None)
+{
+    cout << "finding in " << filename << endl;
+    Gto::Reader reader(mode);
+    if (!reader.open(filename)) return false;
+
+    Gto::Pattern glob("property_[!3]", Gto::Pattern::Glob);
+    Gto::Pattern regex("_[34]$");
+    Gto::Reader::Indices indices;
+    vector<string> names;
+
+    if (reader.findProperties(reader.componentAt(1), glob, indices) != 3 ||
+        indices[0] != 3 || indices[2] != 6 ||
+        reader.findProperties(reader.componentAt(1), regex, indices) != 2 ||
+        reader.findObjects(Gto::Pattern("test?", Gto::Pattern::Glob), indices) != 1 ||
+        reader.findObjects("test", names) != 2)
+    {
+        return false;
+    }
+
+    return reader.findObject("test2") == 1 &&
+           reader.findObject("nothing") == -1 &&
+           reader.findComponent("test2", "component_1") == 1 &&
+           reader.findProperty("test", "component_1", "property_3") == 2 &&
+           reader.findProperty("test2", "component_1", "property_4") == 6 &&
+           reader.findProperty("test", "component_1", "property_4") == -1 &&
+           reader.getProperty("test2", "component_1", "property_1") == 
+               &reader.propertyAt(3);
+}
+
 int main(int, char**)
 {
     struct stat s;
+    bool ok = true;
     write("test.gto");
     read("test.gto");
+    ok = checkFind("test.gto") && ok;
+    ok = checkFind("test.gto", Gto::Reader::LazyStrings) && ok;
+    ok = check("test.gto", Gto::Reader::LazyStrings | 
+                           Gto::Reader::MemoryMapped, true) && ok;
+    ok = checkSequence() && ok;
+    ok = checkParallelFor() && ok;
+    ok = checkSwapKernels() && ok;
+    ok = checkSwappedFile() && ok;
+    ok = checkArena("test.gto") && ok;
+    ok = checkSharedStrings() && ok;
+    ok = check("test.gto", Gto::Reader::None, false) && ok;
+    ok = check("test.gto", Gto::Reader::MemoryMapped, true) && ok;
+    ok = check("test.gto", Gto::Reader::MemoryMapped | 
+                           Gto::Reader::RandomAccess, true) && ok;
+    ok = check("test.gto", Gto::Reader::RandomAccess, false, 2) && ok;
+    ok = check("test.gto", Gto::Reader::MemoryMapped | 
+                           Gto::Reader::RandomAccess, true, 2) && ok;
+    ok = check("test.gto", Gto::Reader::CachedDescription, false) && ok;
+    ok = check("test.gto", Gto::Reader::CachedDescription, false) && ok;
+    ok = check("test.gto", Gto::Reader::CachedDescription | 
+                           Gto::Reader::RandomAccess, false, 2) && ok;
+    ok = checkConcurrent("test.gto") && ok;
+
+    write("test.gto", Gto::Writer::TextGTO);
+    ok = checkFind("test.gto") && ok;
+    ok = checkTextParser() && ok;
+    ok = checkTextNumbers() && ok;
+    ok = checkParallelText() && ok;
+
+    //
+    //  Interleaved components, per property and in one block
+    //
+
+    write("test.gto", Gto::Writer::BinaryGTO, true, 1, 0, true);
+    ok = check("test.gto", Gto::Reader::None, false) && ok;
+    ok = check("test.gto", Gto::Reader::CachedDescription, false) && ok;
+    ok = check("test.gto", Gto::Reader::RandomAccess, false) && ok;
+    ok = check("test.gto", Gto::Reader::MemoryMapped | 
+                           Gto::Reader::RandomAccess, false, 2) && ok;
+    ok = checkConcurrent("test.gto") && ok;
+    ok = checkTransposedQuantization() && ok;
+    write("test.gto", Gto::Writer::TextGTO, true, 1, 0, true);
+    ok = check("test.gto", Gto::Reader::None, false) && ok;
+
+    //
+    //  Filtered properties are never handed out mapped
+    //
+
+    write("test.gto", Gto::Writer::BinaryGTO, true, 1, 
+          Gto::ShuffleFilter | Gto::DeltaFilter);
+    ok = check("test.gto", Gto::Reader::None, false) && ok;
+    ok = checkConcurrent("test.gto") && ok;
+    ok = check("test.gto", Gto::Reader::MemoryMapped | 
+                           Gto::Reader::RandomAccess, false, 2) && ok;
+    unlink("test.gto");
+
+#ifdef GTO_SUPPORT_ZIP
+    //
+    //  Block compressed with an index, then a plain gzip stream
+    //
+
+    write("test.gto.gz", Gto::Writer::CompressedGTO);
+    ok = check("test.gto.gz", Gto::Reader::RandomAccess, false) && ok;
+    ok = check("test.gto.gz", Gto::Reader::RandomAccess, false, 2) && ok;
+    write("test.gto.gz", Gto::Writer::CompressedGTO, true, 3);
+    ok = check("test.gto.gz", Gto::Reader::RandomAccess, false) && ok;
+    write("test.gto.gz", Gto::Writer::CompressedGTO, true, 1, 
+          Gto::ShuffleFilter | Gto::DeltaFilter);
+    ok = check("test.gto.gz", Gto::Reader::RandomAccess, false, 2) && ok;
+
+    if (Gto::Writer::supports(Gto::Writer::LZ4CompressedGTO))
+    {
+        write("test.gto.gz", Gto::Writer::LZ4CompressedGTO);
+        ok = check("test.gto.gz", Gto::Reader::RandomAccess, false, 2) && ok;
+        ok = checkConcurrent("test.gto.gz") && ok;
+    }
+    else
+    {
+        cout << "skipping LZ4, not built in" << endl;
+    }
+
+    if (Gto::Writer::supports(Gto::Writer::ZstdCompressedGTO))
+    {
+        write("test.gto.gz", Gto::Writer::ZstdCompressedGTO);
+        ok = check("test.gto.gz", Gto::Reader::RandomAccess, false, 2) && ok;
+        write("test.gto.gz", Gto::Writer::ZstdCompressedGTO, true, 1, 0, true);
+        ok = check("test.gto.gz", Gto::Reader::RandomAccess, false, 2) && ok;
+    }
+    else
+    {
+        cout << "skipping Zstd, not built in" << endl;
+    }
+
+    write("test.gto.gz", Gto::Writer::CompressedGTO, true, 1, 0, true);
+    ok = check("test.gto.gz", Gto::Reader::RandomAccess, false, 2) && ok;
+    ok = checkConcurrent("test.gto.gz") && ok;
+    ok = checkCompressedRanges() && ok;
+    write("test.gto.gz", Gto::Writer::CompressedGTO, false);
+    ok = check("test.gto.gz", Gto::Reader::None, false) && ok;
+    unlink("test.gto.gz");
+#endif
+
+    //
+    //  Data gathered from spans, strided and non-contiguous sources
+    //
+
+    writeGathered("test.gto");
+    ok = check("test.gto", Gto::Reader::None, false) && ok;
+    writeGathered("test.gto", Gto::Writer::BinaryGTO, Gto::DeltaFilter);
+    ok = check("test.gto", Gto::Reader::None, false) && ok;
+    writeGathered("test.gto", Gto::Writer::TextGTO);
+    ok = check("test.gto", Gto::Reader::None, false) && ok;
+#ifdef GTO_SUPPORT_ZIP
+    writeGathered("test.gto.gz", Gto::Writer::CompressedGTO);
+    ok = check("test.gto.gz", Gto::Reader::RandomAccess, false) && ok;
+    unlink("test.gto.gz");
+#endif
+
+    //
+    //  Streamed files, description in the footer
+    //
+
+    writeStreamed("test.gto");
+    ok = check("test.gto", Gto::Reader::None, false) && ok;
+    ok = check("test.gto", Gto::Reader::MemoryMapped | 
+                           Gto::Reader::RandomAccess, false, 2) && ok;
+    ok = check("test.gto", Gto::Reader::CachedDescription, false) && ok;
+    ok = check("test.gto", Gto::Reader::CachedDescription, false) && ok;
+    ok = checkFind("test.gto") && ok;
+    unlink("test.gto");
+#ifdef GTO_SUPPORT_ZIP
+    writeStreamed("test.gto.gz", Gto::Writer::CompressedGTO);
+    ok = check("test.gto.gz", Gto::Reader::RandomAccess, false) && ok;
+    ok = check("test.gto.gz", Gto::Reader::RandomAccess, false, 2) && ok;
+    unlink("test.gto.gz");
+#endif
+    writeStreamed("test.gto", Gto::Writer::TextGTO);
+    ok = check("test.gto", Gto::Reader::None, false) && ok;
     unlink("test.gto");
 
     if (stat("big_endian.gto",&s) != -1) read("big_endian.gto");
     if (stat("little_endian.gto",&s) != -1) read("little_endian.gto");
+
+    return ok ? 0 : 1;
 }
@@ -73,6 +73,7 @@ void Component::remove( Property *p )
 {
     // This removes the property from the list. The property is NOT deleted.
     GtoContainer::remove( m_properties, p );
+    m_index.rebuild( m_properties );
 }
 
 //-*****************************************************************************
@@ -84,38 +85,26 @@ void Component::remove( const std::string &name )
 //-*****************************************************************************
 void Component::add( Property *p )
 {
-    for ( int i = 0; i < m_properties.size(); ++i )
+    if ( find( p->name() ) )
     {
-	if ( m_properties[i]->name() == p->name() )
-	{
-	    throw UnexpectedExc(
-                ", property with same name already exists" );
-	}
+        throw UnexpectedExc(
+            ", property with same name already exists" );
     }
     
     m_properties.push_back( p );
+    m_index.added( m_properties );
 }
 
 //-*****************************************************************************
 const Property *Component::find( const std::string &name ) const
 {
-    for ( int i = 0; i < m_properties.size(); ++i )
-    {
-	if ( m_properties[i]->name() == name ) { return m_properties[i]; }
-    }
-    
-    return NULL;
+    return m_index.first( m_properties, name );
 }
 
 //-*****************************************************************************
 Property *Component::find( const std::string &name )
 {
-    for ( int i = 0; i < m_properties.size(); ++i )
-    {
-	if ( m_properties[i]->name() == name ) { return m_properties[i]; }
-    }
-
-    return NULL;
+    return m_index.first( m_properties, name );
 }
 
 //-*****************************************************************************
@@ -37,6 +37,7 @@
 #ifndef _GtoContainer_Component_h_
 #define _GtoContainer_Component_h_
 
+#include <GtoContainer/NameIndex.h>
 #include <string>
 #include <vector>
 
@@ -69,9 +70,12 @@ public:
     bool isTransposable() const { return m_transposable; }
     const std::string &name() const { return m_name; }
     
-    // Property management
+    // Property management. find() and add() use a hashed index of
+    // the property names which add() and remove() keep up to date.
+    // Once the non-const properties() has been called the list is
+    // checked against the index on every lookup instead.
     const Container& properties() const  { return m_properties; }
-    Container & properties() { return m_properties; }
+    Container & properties() { m_index.invalidate(); return m_properties; }
 
     void add( Property *p );
     void remove( Property *p );
@@ -113,6 +117,7 @@ public:
 private:
     std::string		m_name;
     Container		m_properties;
+    NameIndex<Property>	m_index;
     bool		m_transposable;
 };
 
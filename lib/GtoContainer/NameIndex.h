@@ -0,0 +1,172 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+//
+
+#ifndef _GtoContainer_NameIndex_h_
+#define _GtoContainer_NameIndex_h_
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GtoContainer {
+
+//-*****************************************************************************
+// class NameIndex
+//
+// Hashed lookup by name() for a vector of pointers. The index keeps a
+// copy of the pointers it has filed. The owner calls added() after
+// appending and rebuild() after removing.
+//
+// Once the vector can be changed behind the owner's back (the owner
+// has handed out a non-const reference to it, which it reports with
+// invalidate(), or the vector is public to begin with) every lookup
+// first compares the vector with that copy and rebuilds the index if
+// anything other than an append happened. So clearing and refilling,
+// swapping or assigning elements is always noticed. Hits are checked
+// against the element's name as well, so an element renamed away is
+// noticed too. Renaming an element *to* a name it is looked up by
+// needs an explicit rebuild().
+//
+// Const lookups may rebuild the index, so they are only safe to make
+// from several threads while the vector is left alone.
+//-*****************************************************************************
+
+template <class T>
+class NameIndex
+{
+public:
+    typedef std::vector<T*> Vector;
+    typedef std::vector<size_t> Positions;
+
+    // With checked set the vector is compared with the index on every
+    // lookup from the start.
+    explicit NameIndex( bool checked = false ) : m_checked( checked ) {}
+
+    // Positions of all elements with the name, in vector order, or
+    // NULL if there are none.
+    const Positions *find( const Vector &v, const std::string &name ) const;
+
+    // The first element with the name or NULL
+    T *first( const Vector &v, const std::string &name ) const
+    {
+        const Positions *p = find( v, name );
+        return p ? v[p->front()] : NULL;
+    }
+
+    void added( const Vector &v ) { update( v ); }
+    void rebuild( const Vector &v ) const;
+
+    // The vector may be changed without the owner knowing from now
+    // on. Drops the index and checks the vector on every lookup.
+    void invalidate();
+
+private:
+    void update( const Vector &v ) const;
+
+    typedef std::unordered_map<std::string, Positions> Map;
+
+    mutable Map     m_map;
+    mutable Vector  m_filed;
+    bool            m_checked;
+};
+
+//-*****************************************************************************
+// TEMPLATE AND INLINE FUNCTIONS
+//-*****************************************************************************
+template <class T>
+const typename NameIndex<T>::Positions *
+NameIndex<T>::find( const Vector &v, const std::string &name ) const
+{
+    update( v );
+
+    typename Map::const_iterator i = m_map.find( name );
+    if ( i == m_map.end() ) { return NULL; }
+
+    for ( size_t q = 0; q < i->second.size(); ++q )
+    {
+        if ( v[i->second[q]]->name() != name )
+        {
+            // Renamed
+            rebuild( v );
+            i = m_map.find( name );
+            return i == m_map.end() ? NULL : &i->second;
+        }
+    }
+
+    return &i->second;
+}
+
+//-*****************************************************************************
+template <class T>
+void NameIndex<T>::update( const Vector &v ) const
+{
+    if ( v.size() < m_filed.size() ||
+         ( m_checked && 
+           !std::equal( m_filed.begin(), m_filed.end(), v.begin() ) ) )
+    {
+        m_map.clear();
+        m_filed.clear();
+    }
+
+    for ( size_t i = m_filed.size(); i < v.size(); ++i )
+    {
+        m_map[v[i]->name()].push_back( i );
+        m_filed.push_back( v[i] );
+    }
+}
+
+//-*****************************************************************************
+template <class T>
+void NameIndex<T>::rebuild( const Vector &v ) const
+{
+    m_map.clear();
+    m_filed.clear();
+    update( v );
+}
+
+//-*****************************************************************************
+template <class T>
+void NameIndex<T>::invalidate()
+{
+    m_map.clear();
+    m_filed.clear();
+    m_checked = true;
+}
+
+} // End namespace GtoContainer
+
+#endif
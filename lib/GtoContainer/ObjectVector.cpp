@@ -48,25 +48,14 @@ void ObjectVector::deleteContents()
     }
     
     erase( begin(), end() );
+    m_index.rebuild( *this );
 }
 
 //-*****************************************************************************
 void ObjectVector::removeWithoutDeleting( const PropertyContainer *pc )
 {
-    iterator startOfFind = begin();
-    while( 1 )
-    {
-        iterator found = std::find( startOfFind, end(), pc );
-        if ( found == end() )
-        {
-            break;
-        }
-
-        startOfFind = found;
-        ++startOfFind;
-
-        erase( found );
-    }
+    erase( std::remove( begin(), end(), pc ), end() );
+    m_index.rebuild( *this );
 }
 
 //-*****************************************************************************
@@ -139,41 +128,26 @@ ObjectVector::findAllOfProtocol(
 //-*****************************************************************************
 PropertyContainer *ObjectVector::findFirstOfName( const std::string &nme )
 {
-    for ( iterator iter = begin(); iter != end(); ++iter )
-    {
-        if ( (*iter)->name() == nme )
-        {
-            return (*iter);
-        }
-    }
-
-    return NULL;
+    return m_index.first( *this, nme );
 }
 
 //-*****************************************************************************
 const PropertyContainer *
 ObjectVector::findFirstOfName( const std::string &nme ) const
 {
-    for ( const_iterator iter = begin(); iter != end(); ++iter )
-    {
-        if ( (*iter)->name() == nme )
-        {
-            return (*iter);
-        }
-    }
-
-    return NULL;
+    return m_index.first( *this, nme );
 }
 
 //-*****************************************************************************
 void ObjectVector::findAllOfName( const std::string &nme,
                                   std::vector<PropertyContainer *> &into )
 {
-    for ( iterator iter = begin(); iter != end(); ++iter )
+    if ( const NameIndex<PropertyContainer>::Positions *p =
+         m_index.find( *this, nme ) )
     {
-        if ( (*iter)->name() == nme )
+        for ( size_t i = 0; i < p->size(); ++i )
         {
-            into.push_back( (*iter) );
+            into.push_back( (*this)[(*p)[i]] );
         }
     }
 }
@@ -185,13 +159,32 @@ ObjectVector::findAllOfName(
     const std::string &nme,
     std::vector<const PropertyContainer *> &into ) const
 {
-    for ( const_iterator iter = begin(); iter != end(); ++iter )
+    if ( const NameIndex<PropertyContainer>::Positions *p =
+         m_index.find( *this, nme ) )
     {
-        if ( (*iter)->name() == nme )
+        for ( size_t i = 0; i < p->size(); ++i )
         {
-            into.push_back( (*iter) );
+            into.push_back( (*this)[(*p)[i]] );
+        }
+    }
+}
+
+//-*****************************************************************************
+PropertyContainer *
+ObjectVector::findLastOfNameAndProtocol( const std::string &nme,
+                                         const Protocol &prot )
+{
+    if ( const NameIndex<PropertyContainer>::Positions *p =
+         m_index.find( *this, nme ) )
+    {
+        for ( size_t i = p->size(); i-- > 0; )
+        {
+            PropertyContainer *pc = (*this)[(*p)[i]];
+            if ( pc->protocol() == prot ) { return pc; }
         }
     }
+
+    return NULL;
 }
 
 } // End namespace GtoContainer
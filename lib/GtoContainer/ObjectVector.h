@@ -47,6 +47,7 @@
 //-*****************************************************************************
 
 #include <GtoContainer/PropertyContainer.h>
+#include <GtoContainer/NameIndex.h>
 #include <vector>
 #include <algorithm>
 
@@ -61,7 +62,7 @@ namespace GtoContainer {
 class ObjectVector : public std::vector<PropertyContainer *>
 {
 public:
-    ObjectVector() : std::vector<PropertyContainer *>() {}
+    ObjectVector() : std::vector<PropertyContainer *>(), m_index( true ) {}
 
     // Destruction does NOT delete the contents.
     ~ObjectVector() {}
@@ -105,6 +106,13 @@ public:
                             std::vector<const PropertyContainer *> &i ) const;
 
     //-*************************************************************************
+    // The name searches go through a hashed index. Each search first
+    // compares the pointers in the list with the ones the index was
+    // built from, so any change made through the vector is picked up.
+    // If you rename a container that is already in the list, call
+    // reindex().
+    void reindex() { m_index.rebuild( *this ); }
+
     // Find the first PropertyContainer that matches a particular name
     PropertyContainer *findFirstOfName( const std::string &n );
     const PropertyContainer *findFirstOfName( const std::string &n ) const;
@@ -114,8 +122,13 @@ public:
                         std::vector<PropertyContainer *> &into );
     void findAllOfName( const std::string &p,
                         std::vector<const PropertyContainer *> &i ) const;
-    
-    
+
+    // Find the last PropertyContainer that matches both name and protocol
+    PropertyContainer *findLastOfNameAndProtocol( const std::string &n,
+                                                  const Protocol &p );
+
+private:
+    NameIndex<PropertyContainer> m_index;
 };
 
 //-*****************************************************************************
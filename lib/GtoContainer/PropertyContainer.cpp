@@ -148,16 +148,14 @@ PropertyContainer::emptyContainer() const
 void
 PropertyContainer::add( Component *c )
 {
-    for ( int i = 0; i < m_components.size(); ++i )
+    if ( component( c->name() ) )
     {
-	if ( m_components[i]->name() == c->name() )
-	{
-	    throw UnexpectedExc(
-                ", component with same name already exists" );
-	}
+        throw UnexpectedExc(
+            ", component with same name already exists" );
     }
 
     m_components.push_back(c);
+    m_index.added( m_components );
 }
 
 //-*****************************************************************************
@@ -170,6 +168,7 @@ PropertyContainer::remove( Component *c )
     if ( i != m_components.end() )
     {
         m_components.erase( i );
+        m_index.rebuild( m_components );
     }
 }
 
@@ -194,30 +193,14 @@ PropertyContainer::createComponent( const std::string &name,
 Component*
 PropertyContainer::component( const std::string &name )
 {
-    for ( int i = 0; i < m_components.size(); ++i )
-    {
-	if ( m_components[i]->name() == name )
-	{
-	    return m_components[i];
-	}
-    }
-
-    return 0;
+    return m_index.first( m_components, name );
 }
 
 //-*****************************************************************************
 const Component*
 PropertyContainer::component( const std::string &name ) const
 {
-    for ( int i = 0; i < m_components.size(); ++i )
-    {
-	if ( m_components[i]->name() == name )
-	{
-	    return m_components[i];
-	}
-    }
-
-    return 0;
+    return m_index.first( m_components, name );
 }
 
 //-*****************************************************************************
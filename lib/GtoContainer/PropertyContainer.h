@@ -88,8 +88,11 @@ public:
     // This is essentially "copy from"
     void copy( const PropertyContainer *other );
     
-    // Component Management
-    Components &components() { return m_components; }
+    // Component Management. component() and add() use a hashed index
+    // of the component names which add() and remove() keep up to date.
+    // Once the non-const components() has been called the list is
+    // checked against the index on every lookup instead.
+    Components &components() { m_index.invalidate(); return m_components; }
     const Components &components() const { return m_components; }
 
     virtual void add( Component * );
@@ -163,6 +166,7 @@ protected:
 
 private:
     Components m_components;
+    NameIndex<Component> m_index;
 };
 
 //-*****************************************************************************
@@ -39,12 +39,13 @@
 #include <GtoContainer/StdProperties.h>
 #include <iostream>
 #include <algorithm>
+#include <string.h>
 
 namespace GtoContainer {
 
 //-*****************************************************************************
-Reader::Reader() 
-  : Gto::Reader( 0 ),
+Reader::Reader( unsigned int mode ) 
+  : Gto::Reader( mode ),
     m_useExisting( false ),
     m_objects( NULL )
 {
@@ -116,17 +117,8 @@ Reader::object( const std::string &name,
 
     if ( m_useExisting )
     {
-        for ( int i = 0; i < m_objects->size(); ++i )
-        {
-            PropertyContainer *pc = (*m_objects)[i];
-
-            if ( pc->name() == name &&
-                 pc->protocol() == protocol )
-            {
-                found = true;
-                g = pc;
-            }
-        }
+        g = m_objects->findLastOfNameAndProtocol( name, protocol );
+        found = g != NULL;
     }
     
     if ( !g )
@@ -273,7 +265,10 @@ void *
 Reader::data( const PropertyInfo &info, size_t bytes )
 {
     Property *p = reinterpret_cast<Property*>( info.propertyData );
-    p->resize( info.size );
+
+    // property() sized it during the description pass, so this is
+    // normally a no-op. The data is read straight into the property.
+    if ( p->size() != info.size ) { p->resize( info.size ); }
 
     // no dereferencing empty array's
     if ( p->size() == 0 )
@@ -281,29 +276,78 @@ Reader::data( const PropertyInfo &info, size_t bytes )
         return NULL;
     }
 
-    if ( StringProperty *sp = dynamic_cast<StringProperty*>( p ) )
+    // String ids have to be converted, so they land in a buffer which
+    // is reused from property to property.
+    if ( dynamic_cast<StringProperty*>( p ) )
     {
-        m_tempstrings.resize( sp->size() );
+        m_tempstrings.resize( bytes / sizeof( int ) );
         return &m_tempstrings.front();
     }
 
     return p->rawData();
 }
 
+//-*****************************************************************************
+bool
+Reader::dataMapped( const PropertyInfo &info,
+                    const void *data,
+                    size_t bytes )
+{
+    // Only strings benefit: numeric data would be copied into the
+    // property either way, but string ids can be converted from the
+    // mapped file without going through m_tempstrings.
+    Property *p = reinterpret_cast<Property*>( info.propertyData );
+    StringProperty *sp = dynamic_cast<StringProperty*>( p );
+    if ( !sp ) { return false; }
+
+    if ( sp->size() != info.size ) { sp->resize( info.size ); }
+
+    stringsFromIds( sp->data(), ( const char * )data,
+                    std::min( sp->size(), bytes / sizeof( int ) ) );
+    return true;
+}
+
 //-*****************************************************************************
 void
 Reader::dataRead( const PropertyInfo &info )
 {
     Property *p  = reinterpret_cast<Property*>( info.propertyData );
 
+    if ( m_tempstrings.empty() ) { return; }
+
     if ( StringProperty *sp = dynamic_cast<StringProperty*>( p ) )
     {
-        for ( int i = 0; i < m_tempstrings.size(); ++i )
+        stringsFromIds( sp->data(), ( const char * )&m_tempstrings.front(),
+                        std::min( sp->size(), m_tempstrings.size() ) );
+    }
+
+    // Keeps the capacity for the next string property
+    m_tempstrings.clear();
+}
+
+//-*****************************************************************************
+void
+Reader::stringsFromIds( std::string *out, const char *ids, size_t count )
+{
+    // With LazyStrings only the strings that are used get decoded.
+    // Otherwise the table is complete and is indexed directly.
+    const bool lazy = ( readMode() & LazyStrings ) != 0;
+    const StringTable *table = lazy ? NULL : &stringTable();
+
+    for ( size_t i = 0; i < count; ++i )
+    {
+        int id;
+        memcpy( &id, ids + i * sizeof( int ), sizeof( int ) );
+
+        if ( table && ( unsigned int )id < table->size() )
         {
-            (*sp)[i] = stringFromId( m_tempstrings[i] );
+            out[i] = (*table)[id];
+        }
+        else
+        {
+            // Decodes, or warns and fails on a bad id
+            out[i] = stringFromId( id );
         }
-
-        m_tempstrings.clear();
     }
 }
 
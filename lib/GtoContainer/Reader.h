@@ -66,8 +66,11 @@ public:
     //-*************************************************************************
     typedef Reader::Request                 Request;
     
-    // Constructors
-    Reader();
+    // Constructors. The mode is passed on to Gto::Reader; MemoryMapped,
+    // CachedDescription, LazyStrings and ParallelText are the useful
+    // ones here. With MemoryMapped, string properties are converted
+    // straight from the mapped file.
+    explicit Reader( unsigned int mode = 0 );
     
     virtual ~Reader();
     
@@ -115,6 +118,10 @@ public:
                               const PropertyInfo &header);
 
     virtual void *data( const PropertyInfo &, size_t bytes );
+
+    virtual bool dataMapped( const PropertyInfo &,
+                             const void *data,
+                             size_t bytes );
     virtual void dataRead( const PropertyInfo & );
     // To accomodate some GTO base library implementations which have changed
     // the dataRead signature.
@@ -133,6 +140,10 @@ public:
 protected:
     MetaProperties      m_metaProperties;
 
+private:
+    // Converts count string ids (possibly unaligned) in one pass
+    void stringsFromIds( std::string *out, const char *ids, size_t count );
+
 private:
     bool                m_useExisting;
     ObjectVector*       m_objects;
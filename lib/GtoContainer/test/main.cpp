@@ -37,6 +37,7 @@
 #include <GtoContainer/Reader.h>
 #include <GtoContainer/ObjectVector.h>
 #include <GtoContainer/StdProperties.h>
+#include <GtoContainer/Writer.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <iostream>
@@ -49,18 +50,239 @@ using namespace GtoContainer;
 typedef PropertyContainer::Components Components;
 typedef Component::Properties Properties;
 
+//-*****************************************************************************
+bool checkIndices()
+{
+    printf( "checking name indices\n" );
+
+    PropertyContainer pc( "obj", Protocol( "test", 1 ) );
+    Component *a = pc.createComponent( "a" );
+    Component *b = pc.createComponent( "b" );
+    if ( pc.createComponent( "a" ) != a || pc.component( "b" ) != b )
+    {
+        return false;
+    }
+
+    FloatProperty *x = pc.createProperty<FloatProperty>( "a", "x" );
+    IntProperty *y = pc.createProperty<IntProperty>( "a", "y" );
+    if ( a->find( "x" ) != x || a->find( "y" ) != y ) { return false; }
+
+    bool threw = false;
+    FloatProperty duplicate( "x" );
+    try { a->add( &duplicate ); }
+    catch ( std::exception & ) { threw = true; }
+    if ( !threw ) { return false; }
+
+    pc.removeProperty( x );
+    delete x;
+    if ( a->find( "x" ) || a->find( "y" ) != y ) { return false; }
+
+    pc.remove( a );
+    delete a;
+    if ( pc.component( "a" ) || pc.component( "b" ) != b ) { return false; }
+
+    ObjectVector objs;
+    PropertyContainer p0( "p", Protocol( "one", 1 ) );
+    PropertyContainer p1( "q", Protocol( "one", 1 ) );
+    PropertyContainer p2( "p", Protocol( "two", 1 ) );
+    objs.push_back( &p0 );
+    if ( objs.findFirstOfName( "p" ) != &p0 ) { return false; }
+    objs.push_back( &p1 );
+    objs.push_back( &p2 );
+
+    std::vector<PropertyContainer *> all;
+    objs.findAllOfName( "p", all );
+    if ( all.size() != 2 || all[0] != &p0 || all[1] != &p2 ||
+         objs.findLastOfNameAndProtocol( "p", Protocol( "one", 1 ) ) != &p0 ||
+         objs.findLastOfNameAndProtocol( "q", Protocol( "two", 1 ) ) )
+    {
+        return false;
+    }
+
+    // Changes made directly to the vector
+    objs.erase( objs.begin() );
+    if ( objs.findFirstOfName( "p" ) != &p2 ||
+         objs.findFirstOfName( "q" ) != &p1 )
+    {
+        return false;
+    }
+
+    p1.setName( "r" );
+    objs.reindex();
+    if ( objs.findFirstOfName( "q" ) || objs.findFirstOfName( "r" ) != &p1 )
+    {
+        return false;
+    }
+
+    objs.removeWithoutDeleting( &p2 );
+    return !objs.findFirstOfName( "p" ) && objs.size() == 1;
+}
+
+//-*****************************************************************************
+// Lists changed through the non-const accessors after the index was
+// built: cleared and refilled to the same size, swapped, and with an
+// element replaced.
+bool checkIndexChanges()
+{
+    printf( "checking name indices after direct changes\n" );
+
+    Component c( "c" );
+    c.add( new FloatProperty( "x" ) );
+    c.add( new FloatProperty( "y" ) );
+    if ( !c.find( "x" ) ) { return false; }
+
+    Properties &props = c.properties();
+    Properties old( props );
+    props.clear();
+    props.push_back( new FloatProperty( "z" ) );
+    props.push_back( new FloatProperty( "w" ) );
+
+    bool threw = false;
+    FloatProperty duplicate( "w" );
+    try { c.add( &duplicate ); }
+    catch ( std::exception & ) { threw = true; }
+    if ( !threw || !c.find( "z" ) || c.find( "x" ) ) { return false; }
+
+    props.swap( old );
+    if ( !c.find( "x" ) || c.find( "z" ) ) { return false; }
+
+    Property *t = new FloatProperty( "t" );
+    std::swap( props[0], t );
+    old.push_back( t );
+    if ( c.find( "t" ) != props[0] || c.find( "x" ) ) { return false; }
+
+    for ( size_t i = 0; i < old.size(); ++i ) { delete old[i]; }
+
+    PropertyContainer pc( "obj", Protocol( "test", 1 ) );
+    pc.createComponent( "a" );
+    if ( !pc.component( "a" ) ) { return false; }
+
+    Components &comps = pc.components();
+    Component *a = comps[0];
+    comps.clear();
+    comps.push_back( new Component( "b" ) );
+    if ( !pc.component( "b" ) || pc.component( "a" ) ) { return false; }
+
+    Component *b = comps[0];
+    comps[0] = a;
+    if ( pc.component( "a" ) != a || pc.component( "b" ) ) { return false; }
+    delete b;
+
+    ObjectVector objs;
+    PropertyContainer p0( "p", Protocol( "one", 1 ) );
+    PropertyContainer p1( "q", Protocol( "one", 1 ) );
+    PropertyContainer p2( "r", Protocol( "one", 1 ) );
+    objs.push_back( &p0 );
+    if ( objs.findFirstOfName( "p" ) != &p0 ) { return false; }
+
+    objs.clear();
+    objs.push_back( &p1 );
+    if ( objs.findFirstOfName( "q" ) != &p1 || objs.findFirstOfName( "p" ) )
+    {
+        return false;
+    }
+
+    ObjectVector others;
+    others.push_back( &p0 );
+    objs.swap( others );
+    if ( objs.findFirstOfName( "p" ) != &p0 || objs.findFirstOfName( "q" ) ||
+         others.findFirstOfName( "q" ) != &p1 )
+    {
+        return false;
+    }
+
+    objs[0] = &p2;
+    return objs.findFirstOfName( "r" ) == &p2 && !objs.findFirstOfName( "p" );
+}
+
+//-*****************************************************************************
+// Writes string and float properties and reads them back with the
+// plain, mapped and read-into-existing paths.
+bool checkReadPaths()
+{
+    const char *names[] = { "paths.gto", "paths_text.gto" };
+    const char *strs[] = { "alpha", "beta", "alpha", "" };
+    bool ok = true;
+
+    {
+        ObjectVector out;
+        PropertyContainer *pc =
+            new PropertyContainer( "obj", Protocol( "test", 1 ) );
+        StringProperty *s = pc->createProperty<StringProperty>( "c", "s" );
+        FloatProperty *f = pc->createProperty<FloatProperty>( "c", "f" );
+        for ( int i = 0; i < 4; ++i ) { s->push_back( strs[i] ); }
+        for ( int i = 0; i < 1000; ++i ) { f->push_back( i * 0.5f ); }
+        out.push_back( pc );
+
+        Writer binary, text;
+        ok = binary.write( names[0], out, Gto::Writer::BinaryGTO ) &&
+             text.write( names[1], out, Gto::Writer::TextGTO );
+        out.deleteContents();
+    }
+
+    for ( int n = 0; n < 2 && ok; ++n )
+    {
+        for ( int mode = 0; mode < 3 && ok; ++mode )
+        {
+            printf( "checking read paths of %s (%d)\n", names[n], mode );
+
+            ObjectVector objs;
+            PropertyContainer *existing = NULL;
+
+            if ( mode == 2 )
+            {
+                // Read into an existing, differently sized property
+                existing = new PropertyContainer( "obj", Protocol( "test", 1 ) );
+                existing->createProperty<StringProperty>( "c", "s" )
+                    ->push_back( "old" );
+                objs.push_back( existing );
+            }
+
+            Reader reader( mode == 1 ? Gto::Reader::MemoryMapped : 0 );
+
+            try { reader.read( names[n], objs, mode == 2 ); }
+            catch ( std::exception &exc )
+            {
+                std::cerr << "EXCEPTION: " << exc.what() << std::endl;
+            }
+
+            StringProperty *s = objs.size() == 1
+                ? objs[0]->property<StringProperty>( "c", "s" ) : NULL;
+            FloatProperty *f = objs.size() == 1
+                ? objs[0]->property<FloatProperty>( "c", "f" ) : NULL;
+
+            ok = ( !existing || objs[0] == existing ) &&
+                 s && s->size() == 4 && f && f->size() == 1000 &&
+                 (*f)[0] == 0.0f && (*f)[999] == 499.5f;
+
+            for ( int i = 0; ok && i < 4; ++i ) { ok = (*s)[i] == strs[i]; }
+
+            objs.deleteContents();
+        }
+    }
+
+    remove( names[0] );
+    remove( names[1] );
+    return ok;
+}
+
 //-*****************************************************************************
 int main( int argc, char **argv )
 {
     if( argc != 2 )
     {
+        // make check runs the tests without arguments
+        bool ok = checkIndices();
+        ok = checkIndexChanges() && ok;
+        ok = checkReadPaths() && ok;
+
         printf("GTO to GTOascii v 3.4\n");
         printf("\n");
         printf("Usage: %s [options]\n", argv[0]);
         printf("\n");
         printf("%%S     GTO file to review\n");
         printf("\n");
-        return 0;
+        return ok ? 0 : 1;
     }
     
     char *gtoFileName = argv[1];
@@ -808,6 +808,12 @@ bool initWriter(PyObject *module)
     value = PyInt_FromLong( Gto::Writer::CompressedGTO );
     PyDict_SetItemString( classMembers, "CompressedGTO", value );
     Py_DECREF(value);
+    value = PyInt_FromLong( Gto::Writer::LZ4CompressedGTO );
+    PyDict_SetItemString( classMembers, "LZ4CompressedGTO", value );
+    Py_DECREF(value);
+    value = PyInt_FromLong( Gto::Writer::ZstdCompressedGTO );
+    PyDict_SetItemString( classMembers, "ZstdCompressedGTO", value );
+    Py_DECREF(value);
 
     INIT_REFCNT(WriterType);
     WriterType.tp_name = "_gto.Writer";